@@ -11,7 +11,79 @@ CREATE TABLE `guild_bans` (
   `bannedBy` VARCHAR(50) NOT NULL DEFAULT '' COMMENT 'Name of player who issued the ban',
   `banReason` VARCHAR(255) NOT NULL DEFAULT '' COMMENT 'Reason for the ban',
   `banType` TINYINT UNSIGNED NOT NULL DEFAULT 0 COMMENT '0 = character ban, 1 = account ban',
+  `updatedAt` TIMESTAMP(3) NOT NULL DEFAULT CURRENT_TIMESTAMP(3) ON UPDATE CURRENT_TIMESTAMP(3) COMMENT 'Last change, read by incremental syncs',
   PRIMARY KEY (`guildId`, `guid`),
   KEY `idx_guildId` (`guildId`),
-  KEY `idx_accountId` (`guildId`, `accountId`)
+  KEY `idx_accountId` (`guildId`, `accountId`),
+  KEY `idx_updatedAt` (`updatedAt`),
+  KEY `idx_guid` (`guid`),
+  KEY `idx_account` (`accountId`)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Guild ban/blacklist system';
+
+-- Keys of deleted bans, so incremental syncs can drop them from memory
+
+DROP TABLE IF EXISTS `guild_bans_deleted`;
+CREATE TABLE `guild_bans_deleted` (
+  `guildId` INT UNSIGNED NOT NULL COMMENT 'Guild ID',
+  `guid` INT UNSIGNED NOT NULL COMMENT 'Banned character GUID',
+  `deletedAt` TIMESTAMP(3) NOT NULL DEFAULT CURRENT_TIMESTAMP(3) COMMENT 'Deletion time',
+  PRIMARY KEY (`guildId`, `guid`),
+  KEY `idx_deletedAt` (`deletedAt`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Guild ban deletions';
+
+DROP TRIGGER IF EXISTS `guild_bans_after_delete`;
+CREATE TRIGGER `guild_bans_after_delete` AFTER DELETE ON `guild_bans` FOR EACH ROW
+  INSERT INTO `guild_bans_deleted` (`guildId`, `guid`, `deletedAt`) VALUES (OLD.`guildId`, OLD.`guid`, CURRENT_TIMESTAMP(3))
+  ON DUPLICATE KEY UPDATE `deletedAt` = CURRENT_TIMESTAMP(3);
+
+-- Keys of changed bans and shared lists, tailed by worldservers sharing this database (GuildBan.ChangeLog.Enable)
+
+DROP TABLE IF EXISTS `guild_bans_log`;
+CREATE TABLE `guild_bans_log` (
+  `seq` BIGINT UNSIGNED NOT NULL AUTO_INCREMENT COMMENT 'Monotonic change sequence',
+  `guildId` INT UNSIGNED NOT NULL COMMENT 'Guild ID',
+  `guid` INT UNSIGNED NOT NULL COMMENT 'Changed character GUID, 0 = all bans of the guild were removed',
+  `type` TINYINT UNSIGNED NOT NULL DEFAULT 0 COMMENT '0 = ban row, 1 = shared lists or subscriptions of the guild',
+  `createdAt` TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP COMMENT 'Used to prune old entries',
+  PRIMARY KEY (`seq`),
+  KEY `idx_createdAt` (`createdAt`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Guild ban change log';
+
+-- Append-only audit log of ban changes (GuildBan.History.Enable)
+
+DROP TABLE IF EXISTS `guild_bans_history`;
+CREATE TABLE `guild_bans_history` (
+  `id` BIGINT UNSIGNED NOT NULL AUTO_INCREMENT COMMENT 'Event order',
+  `eventDate` INT UNSIGNED NOT NULL COMMENT 'Event timestamp',
+  `guildId` INT UNSIGNED NOT NULL COMMENT 'Guild ID',
+  `guid` INT UNSIGNED NOT NULL COMMENT 'Character GUID, 0 = all bans of the guild',
+  `accountId` INT UNSIGNED NOT NULL DEFAULT 0 COMMENT 'Account ID of the ban',
+  `action` TINYINT UNSIGNED NOT NULL COMMENT '0 = ban, 1 = unban, 2 = expired, 3 = purged',
+  `banType` TINYINT UNSIGNED NOT NULL DEFAULT 0 COMMENT '0 = character ban, 1 = account ban',
+  `actor` VARCHAR(50) NOT NULL DEFAULT '' COMMENT 'Name of who made the change',
+  `reason` VARCHAR(255) NOT NULL DEFAULT '' COMMENT 'Reason of the ban',
+  `unbanDate` INT UNSIGNED NOT NULL DEFAULT 0 COMMENT 'Unban timestamp of the ban (0 = permanent)',
+  PRIMARY KEY (`id`),
+  KEY `idx_guild` (`guildId`, `id`),
+  KEY `idx_guild_guid` (`guildId`, `guid`, `id`),
+  KEY `idx_eventDate` (`eventDate`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Guild ban history';
+
+-- Shared ban lists, each ban is stored once in guild_bans and enforced by every subscribed guild
+
+DROP TABLE IF EXISTS `guild_ban_lists`;
+CREATE TABLE `guild_ban_lists` (
+  `listId` INT UNSIGNED NOT NULL COMMENT 'List ID, its bans are stored in guild_bans under guildId 0x80000000 | listId',
+  `name` VARCHAR(32) NOT NULL COMMENT 'Unique list name',
+  `ownerGuildId` INT UNSIGNED NOT NULL COMMENT 'Guild maintaining the list',
+  PRIMARY KEY (`listId`),
+  UNIQUE KEY `idx_name` (`name`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Shared guild ban lists';
+
+DROP TABLE IF EXISTS `guild_ban_list_subscriptions`;
+CREATE TABLE `guild_ban_list_subscriptions` (
+  `guildId` INT UNSIGNED NOT NULL COMMENT 'Subscribed guild ID',
+  `listId` INT UNSIGNED NOT NULL COMMENT 'Shared list ID',
+  PRIMARY KEY (`guildId`, `listId`),
+  KEY `idx_listId` (`listId`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Guilds enforcing shared ban lists';
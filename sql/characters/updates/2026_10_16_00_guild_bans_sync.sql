@@ -0,0 +1,19 @@
+-- Incremental sync support for installs created before `updatedAt` existed
+
+ALTER TABLE `guild_bans`
+  ADD COLUMN `updatedAt` TIMESTAMP(3) NOT NULL DEFAULT CURRENT_TIMESTAMP(3) ON UPDATE CURRENT_TIMESTAMP(3) COMMENT 'Last change, read by incremental syncs' AFTER `banType`,
+  ADD KEY `idx_updatedAt` (`updatedAt`);
+
+DROP TABLE IF EXISTS `guild_bans_deleted`;
+CREATE TABLE `guild_bans_deleted` (
+  `guildId` INT UNSIGNED NOT NULL COMMENT 'Guild ID',
+  `guid` INT UNSIGNED NOT NULL COMMENT 'Banned character GUID',
+  `deletedAt` TIMESTAMP(3) NOT NULL DEFAULT CURRENT_TIMESTAMP(3) COMMENT 'Deletion time',
+  PRIMARY KEY (`guildId`, `guid`),
+  KEY `idx_deletedAt` (`deletedAt`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Guild ban deletions';
+
+DROP TRIGGER IF EXISTS `guild_bans_after_delete`;
+CREATE TRIGGER `guild_bans_after_delete` AFTER DELETE ON `guild_bans` FOR EACH ROW
+  INSERT INTO `guild_bans_deleted` (`guildId`, `guid`, `deletedAt`) VALUES (OLD.`guildId`, OLD.`guid`, CURRENT_TIMESTAMP(3))
+  ON DUPLICATE KEY UPDATE `deletedAt` = CURRENT_TIMESTAMP(3);
@@ -0,0 +1,11 @@
+-- Keys of changed bans, tailed by worldservers sharing this database (GuildBan.ChangeLog.Enable)
+
+DROP TABLE IF EXISTS `guild_bans_log`;
+CREATE TABLE `guild_bans_log` (
+  `seq` BIGINT UNSIGNED NOT NULL AUTO_INCREMENT COMMENT 'Monotonic change sequence',
+  `guildId` INT UNSIGNED NOT NULL COMMENT 'Guild ID',
+  `guid` INT UNSIGNED NOT NULL COMMENT 'Changed character GUID, 0 = all bans of the guild were removed',
+  `createdAt` TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP COMMENT 'Used to prune old entries',
+  PRIMARY KEY (`seq`),
+  KEY `idx_createdAt` (`createdAt`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Guild ban change log';
@@ -0,0 +1,5 @@
+-- Cross-guild lookups by character or account
+
+ALTER TABLE `guild_bans`
+  ADD KEY `idx_guid` (`guid`),
+  ADD KEY `idx_account` (`accountId`);
@@ -0,0 +1,19 @@
+-- Audit log of ban changes
+
+DROP TABLE IF EXISTS `guild_bans_history`;
+CREATE TABLE `guild_bans_history` (
+  `id` BIGINT UNSIGNED NOT NULL AUTO_INCREMENT COMMENT 'Event order',
+  `eventDate` INT UNSIGNED NOT NULL COMMENT 'Event timestamp',
+  `guildId` INT UNSIGNED NOT NULL COMMENT 'Guild ID',
+  `guid` INT UNSIGNED NOT NULL COMMENT 'Character GUID, 0 = all bans of the guild',
+  `accountId` INT UNSIGNED NOT NULL DEFAULT 0 COMMENT 'Account ID of the ban',
+  `action` TINYINT UNSIGNED NOT NULL COMMENT '0 = ban, 1 = unban, 2 = expired, 3 = purged',
+  `banType` TINYINT UNSIGNED NOT NULL DEFAULT 0 COMMENT '0 = character ban, 1 = account ban',
+  `actor` VARCHAR(50) NOT NULL DEFAULT '' COMMENT 'Name of who made the change',
+  `reason` VARCHAR(255) NOT NULL DEFAULT '' COMMENT 'Reason of the ban',
+  `unbanDate` INT UNSIGNED NOT NULL DEFAULT 0 COMMENT 'Unban timestamp of the ban (0 = permanent)',
+  PRIMARY KEY (`id`),
+  KEY `idx_guild` (`guildId`, `id`),
+  KEY `idx_guild_guid` (`guildId`, `guid`, `id`),
+  KEY `idx_eventDate` (`eventDate`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Guild ban history';
@@ -0,0 +1,18 @@
+-- Shared ban lists that guilds can subscribe to
+
+DROP TABLE IF EXISTS `guild_ban_lists`;
+CREATE TABLE `guild_ban_lists` (
+  `listId` INT UNSIGNED NOT NULL COMMENT 'List ID, its bans are stored in guild_bans under guildId 0x80000000 | listId',
+  `name` VARCHAR(32) NOT NULL COMMENT 'Unique list name',
+  `ownerGuildId` INT UNSIGNED NOT NULL COMMENT 'Guild maintaining the list',
+  PRIMARY KEY (`listId`),
+  UNIQUE KEY `idx_name` (`name`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Shared guild ban lists';
+
+DROP TABLE IF EXISTS `guild_ban_list_subscriptions`;
+CREATE TABLE `guild_ban_list_subscriptions` (
+  `guildId` INT UNSIGNED NOT NULL COMMENT 'Subscribed guild ID',
+  `listId` INT UNSIGNED NOT NULL COMMENT 'Shared list ID',
+  PRIMARY KEY (`guildId`, `listId`),
+  KEY `idx_listId` (`listId`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci COMMENT='Guilds enforcing shared ban lists';
@@ -0,0 +1,4 @@
+-- Shared list and subscription changes in guild_bans_log (GuildBan.ChangeLog.Enable)
+
+ALTER TABLE `guild_bans_log`
+  ADD COLUMN `type` TINYINT UNSIGNED NOT NULL DEFAULT 0 COMMENT '0 = ban row, 1 = shared lists or subscriptions of the guild' AFTER `guid`;
@@ -18,69 +18,482 @@
 #ifndef _GUILD_BAN_H_
 #define _GUILD_BAN_H_
 
+#include "AsyncCallbackProcessor.h"
 #include "Common.h"
+#include "DatabaseEnvFwd.h"
+#include "GuildBanChangeLog.h"
+#include "GuildBanStats.h"
 #include "ObjectGuid.h"
+#include "Optional.h"
+#include "QueryCallbackProcessor.h"
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <queue>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <unordered_set>
 
-enum GuildBanType
+class Guild;
+
+// Characters of an account looked up recently, see GuildBanMgr::GetAccountCharacters
+struct GuildBanAccountCharacters
+{
+    std::vector<uint32> guids;
+    std::list<uint32>::iterator lru;
+};
+
+enum GuildBanWriteOp : uint8
 {
-    GUILD_BAN_CHARACTER = 0,
-    GUILD_BAN_ACCOUNT   = 1
+    GUILD_BAN_WRITE_SAVE   = 0,
+    GUILD_BAN_WRITE_DELETE = 1
 };
 
-struct GuildBanInfo
+// Last queued database operation for one (guildId, guid) row
+struct GuildBanPendingWrite
 {
+    GuildBanWriteOp op;
+    GuildBanInfo info;
+};
+
+// Named ban list maintained by one guild and checked by every guild subscribed to it.
+// Its bans are stored once, under MakeGuildBanListGuildId(id).
+struct GuildBanList
+{
+    uint32 id;
+    std::string name;
+    uint32 ownerGuildId;
+};
+
+// Join attempts a banned player may make before further ones are rejected silently
+struct GuildBanJoinBucket
+{
+    uint32 tokens;
+    uint32 lastRefill; // getMSTime() of the last token added
+};
+
+enum GuildBanHistoryAction : uint8
+{
+    GUILD_BAN_HISTORY_BAN    = 0,
+    GUILD_BAN_HISTORY_UNBAN  = 1,
+    GUILD_BAN_HISTORY_EXPIRE = 2,
+    GUILD_BAN_HISTORY_PURGE  = 3  // guild disbanded (guid 0) or character deleted
+};
+
+// One row of guild_bans_history. Removals carry the type and reason of the lifted ban.
+struct GuildBanHistoryEvent
+{
+    uint32 date;
     uint32 guildId;
     uint32 guid;
     uint32 accountId;
-    uint32 banDate;
     uint32 unbanDate;
-    std::string bannedBy;
-    std::string banReason;
+    GuildBanHistoryAction action;
     GuildBanType banType;
+    std::string actor;
+    std::string reason;
 };
 
+// Fixed size ring of the most recent history events, the oldest is overwritten when full
+class GuildBanHistory
+{
+public:
+    void Resize(uint32 capacity)
+    {
+        _events.clear();
+        _events.shrink_to_fit();
+        _events.reserve(capacity);
+        _capacity = capacity;
+        _next = 0;
+    }
+
+    void Push(GuildBanHistoryEvent const& event)
+    {
+        if (!_capacity)
+            return;
+
+        if (_events.size() < _capacity)
+            _events.push_back(event);
+        else
+            _events[_next] = event;
+
+        _next = (_next + 1) % _capacity;
+    }
+
+    // Newest first, stops when the callback returns false
+    template<typename Callback>
+    void ForEachNewest(Callback&& callback) const
+    {
+        for (std::size_t i = 1; i <= _events.size(); ++i)
+            if (!callback(_events[(_next + _capacity - i) % _capacity]))
+                return;
+    }
+
+    uint32 Capacity() const { return _capacity; }
+
+    // Date of the oldest event held, 0 when empty
+    uint32 OldestDate() const
+    {
+        if (_events.empty())
+            return 0;
+
+        return _events[_events.size() < _capacity ? 0 : _next].date;
+    }
+
+    std::size_t MemoryUsage() const
+    {
+        std::size_t total = _events.capacity() * sizeof(GuildBanHistoryEvent);
+        for (GuildBanHistoryEvent const& event : _events)
+            total += event.actor.capacity() + event.reason.capacity();
+
+        return total;
+    }
+
+private:
+    std::vector<GuildBanHistoryEvent> _events;
+    uint32 _capacity = 0;
+    uint32 _next = 0;
+};
+
+// Outcome of a consistency pass between the loaded bans and guild_bans
+struct GuildBanVerifyReport
+{
+    uint32 startedAt = 0;
+    uint32 finishedAt = 0; // 0 while running or when aborted by a reload
+    uint64 rowsChecked = 0;
+    uint32 missingInMemory = 0;
+    uint32 missingInDatabase = 0;
+    uint32 differing = 0;
+    uint32 indexDrift = 0;
+    uint32 repaired = 0;
+};
+
+struct GuildBanMemoryStats
+{
+    std::size_t index;
+    std::size_t store;
+    std::size_t accountCache;
+    std::size_t history;
+    // Lazy mode: approximate size of the ban details in memory and the guilds they belong to
+    std::size_t guildDetails;
+    uint32 detailGuilds;
+    uint32 bans;
+    uint32 pendingWrites;
+    uint32 cachedAccounts;
+};
+
+// Guild whose ban details are in memory in lazy mode, see GuildBanMgr::LoadGuildDetails
+struct GuildBanDetailGuild
+{
+    std::list<uint32>::iterator lru;
+    std::size_t bytes;
+};
+
+// Lookups (IsBanned, IsCharacterBanned, IsAccountBanned) are safe from any thread and
+// never block. Everything else, including all mutators, belongs to the world thread.
 class GuildBanMgr
 {
 public:
+    // The server uses the sGuildBanMgr instance, separate instances are for tests
+    GuildBanMgr() = default;
+    ~GuildBanMgr() = default;
+
+    GuildBanMgr(GuildBanMgr const&) = delete;
+    GuildBanMgr& operator=(GuildBanMgr const&) = delete;
+
     static GuildBanMgr* instance();
 
+    // Startup load: from the snapshot file when configured and readable, otherwise from the database
+    void Load();
     void LoadFromDB();
+    // Applies rows changed or deleted in guild_bans since the last load or sync, without a full reload
+    void SyncFromDB();
+    // Applies bans changed by other worldservers sharing the characters database, see guild_bans_log
+    void PollChangeLog();
+    // Writes all bans to the snapshot file, on a background thread unless wait is set
+    void SaveSnapshot(bool wait = false);
+    void Update(uint32 diff);
+
+    // Database writes are queued per (guildId, guid) and flushed in one transaction
     void SaveBanToDB(GuildBanInfo const& banInfo);
     void RemoveBanFromDB(uint32 guildId, uint32 guid);
+    void FlushPendingWrites(bool synchronous = false);
 
     bool AddBan(uint32 guildId, uint32 guid, uint32 accountId, std::string const& bannedBy,
                 std::string const& reason, uint32 duration, GuildBanType banType);
-    bool RemoveBan(uint32 guildId, uint32 guid);
+    bool RemoveBan(uint32 guildId, uint32 guid, std::string const& removedBy = "",
+                   GuildBanHistoryAction action = GUILD_BAN_HISTORY_UNBAN);
+    // Bulk variants: one index publish and one database transaction for the whole batch
+    uint32 AddBans(std::span<GuildBanInfo const> bans);
+    uint32 RemoveBans(uint32 guildId, std::span<uint32 const> guids, std::string const& removedBy = "");
+
+    // Throttles the side effects of repeated banned join attempts per (guild, player): returns false
+    // once the player's attempts ran out, the attempt is then rejected without messages
+    bool ConsumeJoinAttempt(uint32 guildId, uint32 guid);
+    // Counts an attempt for the guild's next notification digest
+    void RecordJoinAttempt(uint32 guildId, uint32 guid);
+    // Removes a banned player that got into the guild on the next update, can't be done while it is added
+    void QueueKick(uint32 guildId, ObjectGuid guid) { _pendingKicks.emplace_back(guildId, guid); }
+    // Removes those of the characters that are members of the guild and sends the online members
+    // one roster update for the whole batch; returns how many were removed
+    uint32 RemoveGuildMembers(Guild* guild, std::span<ObjectGuid const> guids, bool isKicking = true);
+
+    // Shared ban lists; names are matched case-insensitively
+    GuildBanList const* GetSharedList(std::string_view name) const;
+    GuildBanList const* GetSharedList(uint32 listId) const;
+    GuildBanList const* CreateSharedList(std::string_view name, uint32 ownerGuildId);
+    // Drops the list, its bans and every subscription to it
+    void DeleteSharedList(uint32 listId);
+    bool Subscribe(uint32 guildId, uint32 listId);
+    bool Unsubscribe(uint32 guildId, uint32 listId);
+    // List ids the guild subscribes to
+    std::vector<uint32> GetSubscriptions(uint32 guildId) const;
+    uint32 GetMaxSubscriptions() const { return _maxSubscriptions; }
+
+    // Lazy mode loads only the fields lookups, expiry and purges need. Dates, officers and reasons
+    // of a guild's bans are read on first use and dropped again from the least recently used guilds.
+    // Calls the callback once the details of all the guilds are in memory, right away when they already are.
+    void LoadGuildDetails(std::vector<uint32> const& guildIds, std::function<void()> callback);
+    // True while the loaded bans lack the details of some guilds
+    bool IsLazyLoaded() const { return _detailsPartial; }
+    uint32 GetLazyMemoryCap() const { return _lazyMemoryCap; }
+
+    // Starts a background pass comparing guild_bans with the loaded bans, false if one is running.
+    // repair fixes what it finds even when GuildBan.Verify.Repair is off.
+    bool StartVerify(bool repair = false);
+    bool IsVerifyRunning() const { return _verifyRunning; }
+    GuildBanVerifyReport const& GetVerifyReport() const { return _verifyReport; }
+
+    // Recent history events held in memory, newest first; older ones are only in guild_bans_history
+    GuildBanHistory const& GetHistory() const { return _history; }
+
+    // Cross-guild lookups through the reverse indexes
+    std::vector<GuildBanEntry> GetCharacterBans(uint32 guid) const;
+    std::vector<GuildBanEntry> GetAccountBans(uint32 accountId) const;
+
+    // Drop the bans of a disbanded guild or the character bans of a deleted character right away;
+    // guild rows are deleted from the database by a rate-limited background job
+    void PurgeGuild(uint32 guildId);
+    void PurgeCharacter(uint32 guid);
+    // Purges bans of guilds and characters that no longer exist
+    void PurgeOrphans();
 
     bool IsCharacterBanned(uint32 guildId, uint32 guid) const;
     bool IsAccountBanned(uint32 guildId, uint32 accountId) const;
     bool IsBanned(uint32 guildId, uint32 guid, uint32 accountId) const;
 
-    std::vector<GuildBanInfo> GetGuildBans(uint32 guildId) const;
+    GuildBanIndex::FilterStats GetFilterStats() const { return _index.GetFilterStats(); }
+    GuildBanMemoryStats GetMemoryStats() const;
+    // Counters and histograms may be recorded from any thread
+    GuildBanStats& GetStats() const { return _stats; }
+    void LogStats() const;
+
+    Optional<GuildBanEntry> GetBan(uint32 guildId, uint32 guid) const;
+    // Fills page with the guild's bans [offset, offset + limit) in the given order and returns
+    // the guild's total ban count. Strings are not copied, see GuildBanEntry.
+    uint32 GetGuildBanPage(uint32 guildId, uint32 offset, uint32 limit, GuildBanSortOrder order,
+                           std::vector<GuildBanEntry>& page) const;
+
+    // Calls the callback with all characters of the account, right away when the account was
+    // looked up recently or after an async query
+    void GetAccountCharacters(uint32 accountId, std::function<void(std::vector<uint32> const&)> callback);
+    // Keep accounts looked up recently current
+    void AddAccountCharacter(uint32 accountId, uint32 guid);
+    void RemoveAccountCharacter(uint32 accountId, uint32 guid);
 
     // Config
     bool IsEnabled() const { return _enabled; }
     bool AllowOfficerBan() const { return _allowOfficerBan; }
     bool NotifyOnBannedJoinAttempt() const { return _notifyOnBannedJoinAttempt; }
+    std::string const& GetImportDirectory() const { return _importDirectory; }
+    bool PurgeOrphansOnStartup() const { return _purgeOrphansOnStartup; }
+    bool IsHistoryEnabled() const { return _historyEnabled; }
     void LoadConfig();
 
 private:
-    GuildBanMgr() = default;
-    ~GuildBanMgr() = default;
+    void ProcessExpiredBans();
+    void ProcessGuildPurges();
+    void ProcessPendingKicks();
+    // Consistency pass, see GuildBan_Verify.cpp
+    void UpdateVerify(uint32 diff);
+    void FetchVerifyChunk();
+    void CheckVerifyRow(GuildBanInfo const& row);
+    void FinishVerifyGuild();
+    void ConfirmVerifyCandidates();
+    void FinishVerify();
+    void CancelVerify();
+    void LoadSharedLists();
+    // Re-reads shared lists and subscriptions changed by another worldserver. The change log
+    // is not polled again until they are applied.
+    void ReloadSharedLists();
+    void SetSharedLists(QueryResult lists, QueryResult subscriptions);
+    // Publishes the subscriptions to the lookup index
+    void PublishSubscriptions();
+    // Commits a change of guild_ban_lists or guild_ban_list_subscriptions and logs it for the other worldservers
+    void CommitSharedListChange(CharacterDatabaseTransaction trans, uint32 guildId);
+    // Drops the bans, subscriptions and queued writes of a purged guild from memory and queues
+    // the delete of its rows; returns how many bans it had
+    uint32 DropGuild(uint32 guildId, GuildBanIndex::Writer& writer);
+    void SendJoinAttemptDigests();
+    void PruneJoinBuckets();
+    bool CountLookup(bool banned) const;
+    // Removes a ban, recording the removal in the history; false if there was none
+    bool EraseBan(uint32 guildId, uint32 guid, GuildBanHistoryAction action, std::string_view actor, GuildBanIndex::Writer& writer);
+    // Keeps the event in memory and queues its row for the next flush. Bans applied from
+    // the database are not recorded here, the worldserver that changed them already did.
+    void RecordHistory(GuildBanHistoryEvent&& event);
+    void RecordHistory(GuildBanInfo const& info);
+    // Counts the history rows older than the retention period; they are deleted in chunks with the guild purges
+    void PruneHistory();
+    void ProcessHistoryPrune();
+    bool IsLocallyModified(uint64 key) const;
+    bool HasGuildDetails(uint32 guildId) const;
+    // IsSameGuildBan, limited to the fields in memory when the guild's details are not loaded
+    bool IsSameLoadedBan(GuildBanEntry const& ban, GuildBanInfo const& info) const;
+    // LoadGuildDetails of one guild, queries the table unless its details are loaded or on their way
+    void QueryGuildDetails(uint32 guildId, std::function<void()> callback);
+    // Forgets which guilds have their details loaded; partial is set when none of them has
+    void ResetGuildDetails(bool partial);
+    void ForgetGuildDetails(uint32 guildId);
+    // Drops details of the least recently used guilds until the rest fits the memory cap
+    void EvictGuildDetails();
+    // Inserts or replaces a ban read back from the database, returns false if it was unchanged
+    bool ApplyBan(GuildBanInfo const& info, GuildBanIndex::Writer& writer);
+    // Starts tailing guild_bans_log from its current end
+    void InitChangeLog();
+    // Queues a row write without triggering a flush
+    void QueueWrite(GuildBanWriteOp op, uint32 guildId, uint32 guid, GuildBanInfo const& banInfo);
+    // Installs a freshly loaded ban set and returns its size
+    uint32 ReplaceBans(std::vector<std::vector<GuildBanInfo>> const& parts);
+    bool LoadSnapshot();
+    // Compares the loaded snapshot with guild_bans in the background and catches up on mismatch
+    void ValidateSnapshot(uint32 savedAt);
+
+    static constexpr uint32 ExpiryCheckInterval = 1000;
+    static constexpr uint32 HistoryPruneInterval = DAY * IN_MILLISECONDS;
+    // Milliseconds re-read before the watermark, covers transactions that committed out of order
+    static constexpr uint64 SyncLookback = 5000;
+    // Seconds guild_bans_deleted keeps a deletion, an older state cannot be synced forward
+    static constexpr uint32 DeletedRetention = DAY;
+    static constexpr uint32 ChangeLogBatchSize = 1000;
+    // Accounts whose characters stay known after an account ban needed them
+    static constexpr uint32 AccountCacheSize = 256;
 
-    // guildId -> set of banned character guids
-    std::unordered_map<uint32, std::unordered_set<uint32>> _characterBans;
-    // guildId -> set of banned account ids
-    std::unordered_map<uint32, std::unordered_set<uint32>> _accountBans;
+    // (guildId << 32 | guid) of every banned character and (guildId << 32 | accountId)
+    // of every account-wide ban; the only state read by the lookup functions
+    GuildBanIndex _index;
     // Full ban info storage
-    std::unordered_map<uint32, std::vector<GuildBanInfo>> _banInfo;
+    GuildBanStore _bans;
+    // (guildId << 32 | guid) -> write waiting for the next flush
+    std::unordered_map<uint64, GuildBanPendingWrite> _pendingWrites;
+    uint32 _flushTimer = 0;
+    // (guildId << 32 | guid) -> number of flushed but uncommitted writes
+    GuildBanKeyMap _inFlightWrites;
+    // Database time in milliseconds up to which changes have been applied
+    uint64 _syncWatermark = 0;
+    uint32 _syncTimer = 0;
+    bool _syncInProgress = false;
+    // Position in guild_bans_log up to which changes have been applied
+    GuildBanChangeLogCursor _changeLog;
+    uint32 _changeLogTimer = 0;
+    bool _changeLogPollInProgress = false;
+    std::unordered_map<uint32, GuildBanAccountCharacters> _accountCharacters;
+    // Most recently used first
+    std::list<uint32> _accountCharacterLru;
+    // accountId -> callbacks waiting for an account query that is in flight
+    std::unordered_map<uint32, std::vector<std::function<void(std::vector<uint32> const&)>>> _accountCharacterWaiters;
+    QueryCallbackProcessor _queryProcessor;
+    AsyncCallbackProcessor<TransactionCallback> _transactionCallbacks;
+    // Min-heap of temporary bans; stale entries are skipped when they reach the top
+    std::priority_queue<GuildBanExpiry, std::vector<GuildBanExpiry>, std::greater<>> _expiryQueue;
+    uint32 _expiryTimer = 0;
+    // guildId -> rows left to delete, one chunk per purge interval
+    std::deque<std::pair<uint32, uint32>> _guildPurges;
+    uint32 _purgeTimer = 0;
+    // History rows older than _historyPruneBefore left to delete, one chunk per purge interval
+    uint64 _historyPruneRows = 0;
+    uint32 _historyPruneBefore = 0;
+    uint32 _historyPruneTimer = 0;
+    mutable GuildBanStats _stats;
+    uint32 _statsLogTimer = 0;
+    uint32 _snapshotTimer = 0;
+    std::future<void> _snapshotWrite;
+    // (guildId << 32 | guid) -> join attempt tokens, dropped once full again
+    std::unordered_map<uint64, GuildBanJoinBucket> _joinBuckets;
+    // guildId -> guid -> banned join attempts since the last digest
+    std::unordered_map<uint32, std::unordered_map<uint32, uint32>> _joinAttempts;
+    uint32 _joinDigestTimer = 0;
+    std::vector<std::pair<uint32, ObjectGuid>> _pendingKicks;
+    std::unordered_map<uint32, GuildBanList> _sharedLists;
+    // Lower case name -> list id
+    std::unordered_map<std::string, uint32> _sharedListIds;
+    uint32 _nextSharedListId = 1;
+    // World thread copy of the subscriptions, the index holds the published one
+    GuildBanSubscriptions _subscriptions;
+    // Consistency pass state: the table is walked in key order, one chunk at a time
+    bool _verifyRunning = false;
+    bool _verifyQueryInFlight = false;
+    bool _verifyLastChunk = false;
+    bool _verifyTailDone = false;
+    uint32 _verifyPass = 0;
+    uint32 _verifyTimer = 0;
+    uint64 _verifyCursor = 0;
+    std::vector<GuildBanInfo> _verifyRows;
+    std::size_t _verifyRowPos = 0;
+    // Sorted ids of the guilds in memory, to find guilds the table has no rows for
+    std::vector<uint32> _verifyGuilds;
+    std::size_t _verifyGuildPos = 0;
+    uint32 _verifyGuildId = 0;
+    std::vector<uint32> _verifyGuildGuids;
+    uint32 _verifyGuildMatched = 0;
+    // Keys that looked different, read again before they are reported
+    std::vector<uint64> _verifyCandidates;
+    GuildBanVerifyReport _verifyReport;
+    GuildBanHistory _history;
+    // Set while bans were loaded without details, only guilds in _detailGuilds have them
+    bool _detailsPartial = false;
+    std::unordered_map<uint32, GuildBanDetailGuild> _detailGuilds;
+    // Most recently used first
+    std::list<uint32> _detailGuildLru;
+    std::size_t _detailBytes = 0;
+    // guildId -> callbacks waiting for a details query that is in flight
+    std::unordered_map<uint32, std::vector<std::function<void()>>> _detailWaiters;
+    // Events waiting for the next flush, written in the same transaction as the ban rows
+    std::vector<GuildBanHistoryEvent> _pendingHistory;
 
     bool _enabled = true;
     bool _allowOfficerBan = false;
     bool _notifyOnBannedJoinAttempt = true;
+    uint32 _loadThreads = 2;
+    uint32 _loadPageSize = 5000;
+    uint32 _writeFlushInterval = 1000;
+    uint32 _writeBatchSize = 500;
+    uint32 _statsLogInterval = 0;
+    std::string _snapshotFile;
+    uint32 _snapshotInterval = 300000;
+    uint32 _syncInterval = 0;
+    std::string _importDirectory;
+    bool _changeLogEnabled = false;
+    uint32 _changeLogPollInterval = 1000;
+    uint32 _purgeInterval = 1000;
+    uint32 _purgeChunkSize = 1000;
+    bool _purgeOrphansOnStartup = true;
+    uint32 _joinThrottleBurst = 3;
+    uint32 _joinThrottleRefill = 10000;
+    uint32 _joinDigestInterval = 60000;
+    uint32 _maxSubscriptions = 5;
+    uint32 _verifyInterval = 0;
+    uint32 _verifyChunkSize = 500;
+    uint32 _verifyBudget = 200;
+    bool _verifyRepair = false;
+    bool _verifyRepairPass = false;
+    bool _historyEnabled = true;
+    uint32 _historyMemorySize = 1000;
+    uint32 _historyRetentionDays = 0;
+    bool _lazyLoading = false;
+    uint32 _lazyMemoryCap = 4096; // KB
 };
 
 #define sGuildBanMgr GuildBanMgr::instance()
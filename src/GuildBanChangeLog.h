@@ -0,0 +1,129 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GUILD_BAN_CHANGE_LOG_H_
+#define _GUILD_BAN_CHANGE_LOG_H_
+
+#include "GuildBanStore.h"
+#include <span>
+
+enum GuildBanLogType : uint8
+{
+    GUILD_BAN_LOG_BAN          = 0, // the row of (guildId, guid) changed, guid 0 = the guild was purged
+    GUILD_BAN_LOG_SHARED_LISTS = 1  // guild_ban_lists or the subscriptions of guildId changed
+};
+
+// One guild_bans_log entry with the current guild_bans row of its key
+struct GuildBanLogEntry
+{
+    uint64 seq;
+    GuildBanLogType type;
+    uint32 guildId;
+    uint32 guid;
+    Optional<GuildBanInfo> row; // empty once the row was deleted
+};
+
+// Read position in guild_bans_log. A sequence number can be taken by a transaction that commits
+// later, so a batch is only consumed up to its first gap and read past again next time, unless
+// the gap stays open long enough to be a rollback.
+class GuildBanChangeLogCursor
+{
+public:
+    // Milliseconds after which a gap in the log sequence is taken as a rolled back transaction
+    static constexpr uint32 GapTimeout = 10000;
+
+    uint64 GetSeq() const { return _seq; }
+
+    void Reset(uint64 seq)
+    {
+        _seq = seq;
+        _gapSince = 0;
+    }
+
+    // Moves past a batch read after GetSeq(), in sequence order; nowMs is a millisecond clock
+    void Advance(std::span<GuildBanLogEntry const> entries, uint32 nowMs)
+    {
+        if (entries.empty())
+            return;
+
+        uint64 contiguous = _seq;
+        for (GuildBanLogEntry const& entry : entries)
+            if (entry.seq == contiguous + 1)
+                contiguous = entry.seq;
+
+        uint64 highest = entries.back().seq;
+        if (contiguous == highest || (_gapSince && nowMs - _gapSince >= GapTimeout))
+        {
+            _seq = highest;
+            _gapSince = 0;
+        }
+        else
+        {
+            _seq = contiguous;
+
+            if (!_gapSince)
+                _gapSince = nowMs;
+        }
+    }
+
+private:
+    uint64 _seq = 0;
+    uint32 _gapSince = 0;
+};
+
+struct GuildBanLogResult
+{
+    uint32 changed = 0;
+    bool sharedListsChanged = false;
+};
+
+// Applies a batch read from guild_bans_log to one worldserver's bans. Target provides
+//   bool IsLocallyModified(uint64 key)      - local changes not written yet win over the row
+//   bool ApplyBan(GuildBanInfo const&, GuildBanIndex::Writer&)
+//   bool EraseBan(uint32 guildId, uint32 guid, GuildBanIndex::Writer&)
+//   uint32 DropGuild(uint32 guildId, GuildBanIndex::Writer&)
+// Shared lists are not applied here, they are re-read by the caller when the result says so.
+template<typename Target>
+GuildBanLogResult ApplyGuildBanLog(std::span<GuildBanLogEntry const> entries, Target& target, GuildBanIndex::Writer& writer)
+{
+    GuildBanLogResult result;
+
+    for (GuildBanLogEntry const& entry : entries)
+    {
+        if (entry.type == GUILD_BAN_LOG_SHARED_LISTS)
+        {
+            result.sharedListsChanged = true;
+            continue;
+        }
+
+        if (!entry.guid)
+        {
+            result.changed += target.DropGuild(entry.guildId, writer);
+            continue;
+        }
+
+        if (target.IsLocallyModified(MakeGuildBanKey(entry.guildId, entry.guid)))
+            continue;
+
+        if (entry.row ? target.ApplyBan(*entry.row, writer) : target.EraseBan(entry.guildId, entry.guid, writer))
+            ++result.changed;
+    }
+
+    return result;
+}
+
+#endif // _GUILD_BAN_CHANGE_LOG_H_
@@ -0,0 +1,684 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GUILD_BAN_INDEX_H_
+#define _GUILD_BAN_INDEX_H_
+
+#include "Define.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Packs (guildId, guid) or (guildId, accountId) into a single 64-bit key
+inline uint64 MakeGuildBanKey(uint32 guildId, uint32 id)
+{
+    return (uint64(guildId) << 32) | id;
+}
+
+inline uint32 GuildBanKeyGuildId(uint64 key) { return uint32(key >> 32); }
+inline uint32 GuildBanKeyId(uint64 key) { return uint32(key); }
+
+// Entries of a shared ban list are keyed under a guild id with the high bit set, one per list
+constexpr uint32 GuildBanListFlag = 0x80000000;
+
+inline uint32 MakeGuildBanListGuildId(uint32 listId) { return GuildBanListFlag | listId; }
+inline bool IsGuildBanListGuildId(uint32 guildId) { return guildId & GuildBanListFlag; }
+
+// guildId -> list guild ids of the shared ban lists the guild subscribes to
+using GuildBanSubscriptions = std::unordered_map<uint32, std::vector<uint32>>;
+
+// Flat open-addressing set of packed ban keys.
+// Linear probing over a power-of-two slot array; Erase() shifts the following
+// cluster back instead of leaving tombstones, so lookups never degrade over uptime.
+// A zero key marks an empty slot, which is safe because guild ids start at 1.
+class GuildBanKeySet
+{
+public:
+    bool Contains(uint64 key) const
+    {
+        if (!_size)
+            return false;
+
+        for (std::size_t i = Hash(key) & _mask;; i = (i + 1) & _mask)
+        {
+            if (_slots[i] == key)
+                return true;
+
+            if (!_slots[i])
+                return false;
+        }
+    }
+
+    bool Insert(uint64 key)
+    {
+        if (!key)
+            return false;
+
+        if ((_size + 1) * 5 > _slots.size() * 4)
+            Rehash(_slots.empty() ? MinCapacity : _slots.size() * 2);
+
+        std::size_t i = Hash(key) & _mask;
+        for (; _slots[i]; i = (i + 1) & _mask)
+            if (_slots[i] == key)
+                return false;
+
+        _slots[i] = key;
+        ++_size;
+        return true;
+    }
+
+    bool Erase(uint64 key)
+    {
+        if (!_size || !key)
+            return false;
+
+        std::size_t i = Hash(key) & _mask;
+        for (; _slots[i] != key; i = (i + 1) & _mask)
+            if (!_slots[i])
+                return false;
+
+        // Backward-shift deletion: pull later entries of the cluster into the hole
+        // whenever the hole lies between their home slot and their current slot.
+        std::size_t hole = i;
+        for (std::size_t j = (i + 1) & _mask; _slots[j]; j = (j + 1) & _mask)
+        {
+            std::size_t home = Hash(_slots[j]) & _mask;
+            if (((j - home) & _mask) >= ((j - hole) & _mask))
+            {
+                _slots[hole] = _slots[j];
+                hole = j;
+            }
+        }
+
+        _slots[hole] = 0;
+        --_size;
+        return true;
+    }
+
+    void Clear()
+    {
+        _slots.clear();
+        _slots.shrink_to_fit();
+        _mask = 0;
+        _size = 0;
+    }
+
+    void Reserve(std::size_t count)
+    {
+        std::size_t capacity = MinCapacity;
+        while (count * 5 > capacity * 4)
+            capacity *= 2;
+
+        if (capacity > _slots.size())
+            Rehash(capacity);
+    }
+
+    template<class F>
+    void ForEach(F&& f) const
+    {
+        for (uint64 key : _slots)
+            if (key)
+                f(key);
+    }
+
+    std::size_t Size() const { return _size; }
+    std::size_t MemoryUsage() const { return _slots.capacity() * sizeof(uint64); }
+
+    // splitmix64 finalizer; guild ids and guids are small sequential integers
+    static std::size_t Hash(uint64 key)
+    {
+        key ^= key >> 30;
+        key *= 0xBF58476D1CE4E5B9ULL;
+        key ^= key >> 27;
+        key *= 0x94D049BB133111EBULL;
+        key ^= key >> 31;
+        return std::size_t(key);
+    }
+
+private:
+    static constexpr std::size_t MinCapacity = 16;
+
+    void Rehash(std::size_t capacity)
+    {
+        std::vector<uint64> old;
+        old.swap(_slots);
+
+        _slots.assign(capacity, 0);
+        _mask = capacity - 1;
+
+        for (uint64 key : old)
+        {
+            if (!key)
+                continue;
+
+            std::size_t i = Hash(key) & _mask;
+            while (_slots[i])
+                i = (i + 1) & _mask;
+
+            _slots[i] = key;
+        }
+    }
+
+    std::vector<uint64> _slots;
+    std::size_t _mask = 0;
+    std::size_t _size = 0;
+};
+
+// Flat open-addressing map from packed ban keys to 32-bit values, same probing and
+// backward-shift deletion as GuildBanKeySet with the values kept in a parallel array.
+class GuildBanKeyMap
+{
+public:
+    uint32 const* Find(uint64 key) const
+    {
+        if (!_size)
+            return nullptr;
+
+        for (std::size_t i = GuildBanKeySet::Hash(key) & _mask;; i = (i + 1) & _mask)
+        {
+            if (_keys[i] == key)
+                return &_values[i];
+
+            if (!_keys[i])
+                return nullptr;
+        }
+    }
+
+    uint32* Find(uint64 key) { return const_cast<uint32*>(std::as_const(*this).Find(key)); }
+
+    // Returns the value for key, inserting defaultValue first when the key is new
+    uint32& FindOrInsert(uint64 key, uint32 defaultValue = 0)
+    {
+        if ((_size + 1) * 5 > _keys.size() * 4)
+            Rehash(_keys.empty() ? MinCapacity : _keys.size() * 2);
+
+        std::size_t i = GuildBanKeySet::Hash(key) & _mask;
+        for (; _keys[i]; i = (i + 1) & _mask)
+            if (_keys[i] == key)
+                return _values[i];
+
+        _keys[i] = key;
+        _values[i] = defaultValue;
+        ++_size;
+        return _values[i];
+    }
+
+    bool Erase(uint64 key)
+    {
+        if (!_size || !key)
+            return false;
+
+        std::size_t i = GuildBanKeySet::Hash(key) & _mask;
+        for (; _keys[i] != key; i = (i + 1) & _mask)
+            if (!_keys[i])
+                return false;
+
+        std::size_t hole = i;
+        for (std::size_t j = (i + 1) & _mask; _keys[j]; j = (j + 1) & _mask)
+        {
+            std::size_t home = GuildBanKeySet::Hash(_keys[j]) & _mask;
+            if (((j - home) & _mask) >= ((j - hole) & _mask))
+            {
+                _keys[hole] = _keys[j];
+                _values[hole] = _values[j];
+                hole = j;
+            }
+        }
+
+        _keys[hole] = 0;
+        --_size;
+        return true;
+    }
+
+    void Reserve(std::size_t count)
+    {
+        std::size_t capacity = MinCapacity;
+        while (count * 5 > capacity * 4)
+            capacity *= 2;
+
+        if (capacity > _keys.size())
+            Rehash(capacity);
+    }
+
+    std::size_t Size() const { return _size; }
+    std::size_t MemoryUsage() const { return _keys.capacity() * sizeof(uint64) + _values.capacity() * sizeof(uint32); }
+
+private:
+    static constexpr std::size_t MinCapacity = 16;
+
+    void Rehash(std::size_t capacity)
+    {
+        std::vector<uint64> oldKeys;
+        std::vector<uint32> oldValues;
+        oldKeys.swap(_keys);
+        oldValues.swap(_values);
+
+        _keys.assign(capacity, 0);
+        _values.assign(capacity, 0);
+        _mask = capacity - 1;
+
+        for (std::size_t j = 0; j < oldKeys.size(); ++j)
+        {
+            if (!oldKeys[j])
+                continue;
+
+            std::size_t i = GuildBanKeySet::Hash(oldKeys[j]) & _mask;
+            while (_keys[i])
+                i = (i + 1) & _mask;
+
+            _keys[i] = oldKeys[j];
+            _values[i] = oldValues[j];
+        }
+    }
+
+    std::vector<uint64> _keys;
+    std::vector<uint32> _values;
+    std::size_t _mask = 0;
+    std::size_t _size = 0;
+};
+
+// Blocked Bloom filter over the ids banned in any guild, answering "banned nowhere"
+// before the per-guild lookup. Each id sets one bit in each of the 8 words of a single
+// 64-byte block, so a query touches one cache line. Bits are only ever set, with atomic
+// ORs, which lets writers add ids while readers query; removals are handled by rebuilding.
+class GuildBanFilter
+{
+public:
+    static constexpr uint64 AccountTag = uint64(1) << 32;
+    static constexpr std::size_t BitsPerKey = 16;
+
+    static uint64 CharacterId(uint64 key) { return GuildBanKeyId(key); }
+    static uint64 AccountId(uint64 key) { return AccountTag | GuildBanKeyId(key); }
+
+    explicit GuildBanFilter(std::size_t capacity) : _capacity(std::max<std::size_t>(capacity, 64))
+    {
+        std::size_t blocks = 1;
+        while (blocks * BlockBits < _capacity * BitsPerKey)
+            blocks *= 2;
+
+        _blockMask = blocks - 1;
+        _words = std::make_unique<std::atomic<uint64>[]>(blocks * WordsPerBlock);
+    }
+
+    void Add(uint64 id)
+    {
+        uint64 hash = GuildBanKeySet::Hash(id);
+        std::atomic<uint64>* block = &_words[(hash & _blockMask) * WordsPerBlock];
+        uint64 bits = GuildBanKeySet::Hash(hash);
+
+        for (std::size_t i = 0; i < WordsPerBlock; ++i, bits >>= 6)
+            block[i].fetch_or(uint64(1) << (bits & 63), std::memory_order_relaxed);
+
+        _inserted.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool MayContain(uint64 id) const
+    {
+        uint64 hash = GuildBanKeySet::Hash(id);
+        std::atomic<uint64> const* block = &_words[(hash & _blockMask) * WordsPerBlock];
+        uint64 bits = GuildBanKeySet::Hash(hash);
+
+        for (std::size_t i = 0; i < WordsPerBlock; ++i, bits >>= 6)
+            if (!(block[i].load(std::memory_order_relaxed) & (uint64(1) << (bits & 63))))
+                return false;
+
+        return true;
+    }
+
+    // Writer-side bookkeeping, a rebuild is due once the filter is full or mostly stale
+    void NoteRemoved() { _removed.fetch_add(1, std::memory_order_relaxed); }
+    bool NeedsRebuild() const { return Inserted() > _capacity || _removed.load(std::memory_order_relaxed) * 4 > Inserted(); }
+
+    std::size_t Capacity() const { return _capacity; }
+    std::size_t Inserted() const { return _inserted.load(std::memory_order_relaxed); }
+    std::size_t MemoryUsage() const { return (_blockMask + 1) * BlockBits / 8; }
+
+    // Expected false-positive rate for the ids inserted so far
+    double EstimatedFalsePositiveRate() const
+    {
+        double blocks = double(_blockMask + 1);
+        double perWord = std::exp(-double(Inserted()) / blocks / 64.0);
+        return std::pow(1.0 - perWord, double(WordsPerBlock));
+    }
+
+private:
+    static constexpr std::size_t WordsPerBlock = 8;
+    static constexpr std::size_t BlockBits = WordsPerBlock * 64;
+
+    std::unique_ptr<std::atomic<uint64>[]> _words;
+    std::size_t _blockMask = 0;
+    std::size_t _capacity;
+    std::atomic<std::size_t> _inserted = 0;
+    std::atomic<std::size_t> _removed = 0;
+};
+
+// Immutable version of the ban keys. Keys are sharded by guild id so a change to
+// one guild only copies that guild's shard; untouched shards are shared between versions.
+struct GuildBanSnapshot
+{
+    static constexpr uint32 ShardCount = 64;
+
+    static uint32 ShardOf(uint64 key) { return GuildBanKeySet::Hash(GuildBanKeyGuildId(key)) & (ShardCount - 1); }
+
+    std::array<std::shared_ptr<GuildBanKeySet>, ShardCount> characters;
+    std::array<std::shared_ptr<GuildBanKeySet>, ShardCount> accounts;
+    // Shared by every snapshot until a writer rebuilds it
+    std::shared_ptr<GuildBanFilter> filter;
+    // Replaced as a whole when a subscription changes
+    std::shared_ptr<GuildBanSubscriptions const> subscriptions;
+};
+
+// Ban key index with a wait-free read path.
+// Readers never lock: they register in the reader counter of the current epoch and use
+// whatever snapshot is published. Writers (serialized among themselves) copy the shards
+// they touch, publish the new snapshot with a single pointer swap and free the old one
+// after a grace period in which every reader that could still see it has left.
+class GuildBanIndex
+{
+public:
+    GuildBanIndex() : _current(MakeEmpty()) { }
+    ~GuildBanIndex() { delete _current.load(); }
+
+    GuildBanIndex(GuildBanIndex const&) = delete;
+    GuildBanIndex& operator=(GuildBanIndex const&) = delete;
+
+    bool ContainsCharacter(uint64 key) const
+    {
+        ReadGuard guard(*this);
+        if (!guard->filter->MayContain(GuildBanFilter::CharacterId(key)))
+            return false;
+
+        return CountFilterPass(guard->characters[GuildBanSnapshot::ShardOf(key)]->Contains(key));
+    }
+
+    bool ContainsAccount(uint64 key) const
+    {
+        ReadGuard guard(*this);
+        if (!guard->filter->MayContain(GuildBanFilter::AccountId(key)))
+            return false;
+
+        return CountFilterPass(guard->accounts[GuildBanSnapshot::ShardOf(key)]->Contains(key));
+    }
+
+    // Checks the guild's own bans and those of the shared lists it subscribes to,
+    // all answered from the same snapshot
+    bool Contains(uint64 characterKey, uint64 accountKey) const
+    {
+        ReadGuard guard(*this);
+        GuildBanFilter const& filter = *guard->filter;
+
+        bool checkCharacter = filter.MayContain(GuildBanFilter::CharacterId(characterKey));
+        bool checkAccount = GuildBanKeyId(accountKey) && filter.MayContain(GuildBanFilter::AccountId(accountKey));
+
+        if (!checkCharacter && !checkAccount)
+            return false;
+
+        auto containsIn = [&](uint32 guildId)
+        {
+            uint64 character = MakeGuildBanKey(guildId, GuildBanKeyId(characterKey));
+            uint64 account = MakeGuildBanKey(guildId, GuildBanKeyId(accountKey));
+
+            return (checkCharacter && guard->characters[GuildBanSnapshot::ShardOf(character)]->Contains(character)) ||
+                (checkAccount && guard->accounts[GuildBanSnapshot::ShardOf(account)]->Contains(account));
+        };
+
+        uint32 guildId = GuildBanKeyGuildId(characterKey);
+        if (containsIn(guildId))
+            return CountFilterPass(true);
+
+        auto lists = guard->subscriptions->find(guildId);
+        if (lists != guard->subscriptions->end())
+            for (uint32 listGuildId : lists->second)
+                if (containsIn(listGuildId))
+                    return CountFilterPass(true);
+
+        return CountFilterPass(false);
+    }
+
+    std::size_t MemoryUsage() const
+    {
+        ReadGuard guard(*this);
+
+        std::size_t total = sizeof(GuildBanSnapshot) + guard->filter->MemoryUsage();
+        for (uint32 i = 0; i < GuildBanSnapshot::ShardCount; ++i)
+            total += guard->characters[i]->MemoryUsage() + guard->accounts[i]->MemoryUsage();
+
+        return total;
+    }
+
+    struct FilterStats
+    {
+        std::size_t keys;
+        std::size_t bytes;
+        double estimatedFalsePositiveRate;
+        uint64 passes;          // lookups the filter could not rule out
+        uint64 falsePositives;  // ... of which the guild index had no match
+    };
+
+    FilterStats GetFilterStats() const
+    {
+        ReadGuard guard(*this);
+        GuildBanFilter const& filter = *guard->filter;
+        return { filter.Inserted(), filter.MemoryUsage(), filter.EstimatedFalsePositiveRate(),
+            _filterPasses.load(std::memory_order_relaxed), _filterFalsePositives.load(std::memory_order_relaxed) };
+    }
+
+    // Collects changes on private copies of the touched shards and publishes them on Commit()
+    class Writer
+    {
+    public:
+        // When reset is set the edit starts from an empty index instead of the current one
+        Writer(GuildBanIndex& index, bool reset = false) : _index(index), _lock(index._writeLock)
+        {
+            if (reset)
+            {
+                _next.reset(MakeEmpty());
+                _copiedCharacters.set();
+                _copiedAccounts.set();
+                _rebuildFilter = true;
+                // Subscriptions are not ban keys, a reload keeps them
+                _next->subscriptions = _index._current.load()->subscriptions;
+            }
+            else
+                _next = std::make_unique<GuildBanSnapshot>(*_index._current.load());
+        }
+
+        bool InsertCharacter(uint64 key)
+        {
+            if (!Characters(key).Insert(key))
+                return false;
+
+            AddToFilter(GuildBanFilter::CharacterId(key));
+            return true;
+        }
+
+        bool EraseCharacter(uint64 key)
+        {
+            if (!Characters(key).Erase(key))
+                return false;
+
+            _next->filter->NoteRemoved();
+            return true;
+        }
+
+        bool InsertAccount(uint64 key)
+        {
+            if (!Accounts(key).Insert(key))
+                return false;
+
+            AddToFilter(GuildBanFilter::AccountId(key));
+            return true;
+        }
+
+        bool EraseAccount(uint64 key)
+        {
+            if (!Accounts(key).Erase(key))
+                return false;
+
+            _next->filter->NoteRemoved();
+            return true;
+        }
+
+        void SetSubscriptions(std::shared_ptr<GuildBanSubscriptions const> subscriptions)
+        {
+            _next->subscriptions = std::move(subscriptions);
+        }
+
+        void Commit()
+        {
+            if (!_next)
+                return;
+
+            if (_rebuildFilter || _next->filter->NeedsRebuild())
+                RebuildFilter();
+
+            _index.Publish(_next.release());
+        }
+
+    private:
+        GuildBanKeySet& Characters(uint64 key) { return Shard(_next->characters, _copiedCharacters, GuildBanSnapshot::ShardOf(key)); }
+        GuildBanKeySet& Accounts(uint64 key) { return Shard(_next->accounts, _copiedAccounts, GuildBanSnapshot::ShardOf(key)); }
+
+        static GuildBanKeySet& Shard(std::array<std::shared_ptr<GuildBanKeySet>, GuildBanSnapshot::ShardCount>& shards,
+            std::bitset<GuildBanSnapshot::ShardCount>& copied, uint32 shard)
+        {
+            if (!copied.test(shard))
+            {
+                shards[shard] = std::make_shared<GuildBanKeySet>(*shards[shard]);
+                copied.set(shard);
+            }
+
+            return *shards[shard];
+        }
+
+        // The published filter is extended in place; a stray bit only costs a false positive
+        void AddToFilter(uint64 id)
+        {
+            if (_rebuildFilter)
+                return;
+
+            if (_next->filter->Inserted() >= _next->filter->Capacity())
+                _rebuildFilter = true;
+            else
+                _next->filter->Add(id);
+        }
+
+        void RebuildFilter()
+        {
+            std::size_t keys = 0;
+            for (uint32 i = 0; i < GuildBanSnapshot::ShardCount; ++i)
+                keys += _next->characters[i]->Size() + _next->accounts[i]->Size();
+
+            // Headroom so a few new bans do not trigger the next rebuild right away
+            auto filter = std::make_shared<GuildBanFilter>(keys + keys / 4);
+            for (uint32 i = 0; i < GuildBanSnapshot::ShardCount; ++i)
+            {
+                _next->characters[i]->ForEach([&](uint64 key) { filter->Add(GuildBanFilter::CharacterId(key)); });
+                _next->accounts[i]->ForEach([&](uint64 key) { filter->Add(GuildBanFilter::AccountId(key)); });
+            }
+
+            _next->filter = std::move(filter);
+            _rebuildFilter = false;
+        }
+
+        GuildBanIndex& _index;
+        std::lock_guard<std::mutex> _lock;
+        std::unique_ptr<GuildBanSnapshot> _next;
+        std::bitset<GuildBanSnapshot::ShardCount> _copiedCharacters;
+        std::bitset<GuildBanSnapshot::ShardCount> _copiedAccounts;
+        bool _rebuildFilter = false;
+    };
+
+private:
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(GuildBanIndex const& index) : _counter(index._readers[index._epoch.load() & 1].count)
+        {
+            _counter.fetch_add(1);
+            _snapshot = index._current.load();
+        }
+
+        ~ReadGuard() { _counter.fetch_sub(1); }
+
+        GuildBanSnapshot const* operator->() const { return _snapshot; }
+
+    private:
+        std::atomic<uint32>& _counter;
+        GuildBanSnapshot const* _snapshot;
+    };
+
+    static GuildBanSnapshot* MakeEmpty()
+    {
+        GuildBanSnapshot* snapshot = new GuildBanSnapshot();
+        for (uint32 i = 0; i < GuildBanSnapshot::ShardCount; ++i)
+        {
+            snapshot->characters[i] = std::make_shared<GuildBanKeySet>();
+            snapshot->accounts[i] = std::make_shared<GuildBanKeySet>();
+        }
+        snapshot->filter = std::make_shared<GuildBanFilter>(0);
+        snapshot->subscriptions = std::make_shared<GuildBanSubscriptions const>();
+        return snapshot;
+    }
+
+    bool CountFilterPass(bool found) const
+    {
+        _filterPasses.fetch_add(1, std::memory_order_relaxed);
+        if (!found)
+            _filterFalsePositives.fetch_add(1, std::memory_order_relaxed);
+
+        return found;
+    }
+
+    // Called with _writeLock held
+    void Publish(GuildBanSnapshot* next)
+    {
+        GuildBanSnapshot* old = _current.exchange(next);
+
+        // Grace period: flip the epoch twice so both reader counters drain once after the swap
+        for (uint32 round = 0; round < 2; ++round)
+        {
+            uint32 epoch = _epoch.fetch_add(1);
+            while (_readers[epoch & 1].count.load())
+                std::this_thread::yield();
+        }
+
+        delete old;
+    }
+
+    struct alignas(64) ReaderCounter
+    {
+        mutable std::atomic<uint32> count = 0;
+    };
+
+    std::atomic<GuildBanSnapshot*> _current;
+    std::atomic<uint32> _epoch = 0;
+    std::array<ReaderCounter, 2> _readers;
+    std::mutex _writeLock;
+    mutable std::atomic<uint64> _filterPasses = 0;
+    mutable std::atomic<uint64> _filterFalsePositives = 0;
+};
+
+#endif // _GUILD_BAN_INDEX_H_
@@ -0,0 +1,202 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GUILD_BAN_STATS_H_
+#define _GUILD_BAN_STATS_H_
+
+#include "Define.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <string>
+
+enum GuildBanCounter : uint8
+{
+    GUILD_BAN_COUNTER_LOOKUP_HIT     = 0,
+    GUILD_BAN_COUNTER_LOOKUP_MISS    = 1,
+    GUILD_BAN_COUNTER_JOIN_REJECTED  = 2,
+    GUILD_BAN_COUNTER_BAN_ADDED      = 3,
+    GUILD_BAN_COUNTER_BAN_REMOVED    = 4,
+    GUILD_BAN_COUNTER_ROWS_WRITTEN   = 5,
+    GUILD_BAN_COUNTER_WRITES_FAILED  = 6,
+
+    MAX_GUILD_BAN_COUNTERS
+};
+
+enum GuildBanTimer : uint8
+{
+    GUILD_BAN_TIMER_LOOKUP     = 0, // sampled, see GuildBanStats::SampleLookup
+    GUILD_BAN_TIMER_JOIN_CHECK = 1,
+    GUILD_BAN_TIMER_ADD_BAN    = 2,
+    GUILD_BAN_TIMER_REMOVE_BAN = 3,
+    GUILD_BAN_TIMER_DB_WRITE   = 4, // from flush to commit, includes the async queue
+    GUILD_BAN_TIMER_LOAD       = 5,
+
+    MAX_GUILD_BAN_TIMERS
+};
+
+// Log2 histogram of durations in nanoseconds: bucket i holds samples in [2^(i-1), 2^i).
+// Recording is a handful of relaxed atomic adds, so any thread may record.
+class GuildBanHistogram
+{
+public:
+    static constexpr uint32 BucketCount = 48;
+
+    struct Summary
+    {
+        uint64 count;
+        uint64 mean;
+        // Upper bounds of the buckets holding the percentile
+        uint64 p50;
+        uint64 p99;
+        uint64 max;
+    };
+
+    void Record(uint64 nanoseconds)
+    {
+        uint32 bucket = std::min<uint32>(std::bit_width(nanoseconds), BucketCount - 1);
+        _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        _total.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+        uint64 max = _max.load(std::memory_order_relaxed);
+        while (nanoseconds > max && !_max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed));
+    }
+
+    Summary Summarize() const
+    {
+        std::array<uint64, BucketCount> buckets;
+        uint64 count = 0;
+
+        for (uint32 i = 0; i < BucketCount; ++i)
+        {
+            buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+            count += buckets[i];
+        }
+
+        Summary summary = { count, 0, 0, 0, _max.load(std::memory_order_relaxed) };
+        if (!count)
+            return summary;
+
+        summary.mean = _total.load(std::memory_order_relaxed) / count;
+
+        auto percentile = [&](uint64 rank)
+        {
+            uint64 seen = 0;
+            for (uint32 i = 0; i < BucketCount; ++i)
+                if ((seen += buckets[i]) >= rank)
+                    return std::min(i ? uint64(1) << i : 0, summary.max);
+
+            return summary.max;
+        };
+
+        summary.p50 = percentile((count + 1) / 2);
+        summary.p99 = percentile(count - count / 100);
+        return summary;
+    }
+
+private:
+    std::array<std::atomic<uint64>, BucketCount> _buckets = { };
+    std::atomic<uint64> _total = 0;
+    std::atomic<uint64> _max = 0;
+};
+
+// Process-wide counters and latency histograms of the guild ban module
+class GuildBanStats
+{
+public:
+    void Increment(GuildBanCounter counter, uint64 value = 1)
+    {
+        _counters[counter].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64 Get(GuildBanCounter counter) const
+    {
+        return _counters[counter].value.load(std::memory_order_relaxed);
+    }
+
+    void Record(GuildBanTimer timer, std::chrono::steady_clock::duration elapsed)
+    {
+        _timers[timer].Record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    GuildBanHistogram::Summary Summarize(GuildBanTimer timer) const { return _timers[timer].Summarize(); }
+
+    // Lookups take tens of nanoseconds, about as long as reading the clock twice,
+    // so only one in LookupSampleRate per thread is timed
+    static bool SampleLookup()
+    {
+        thread_local uint32 calls = 0;
+        return !(++calls % LookupSampleRate);
+    }
+
+    static constexpr uint32 LookupSampleRate = 64;
+
+private:
+    // Lookup counters are bumped from every map thread, keep them on separate cache lines
+    struct alignas(64) Counter
+    {
+        std::atomic<uint64> value = 0;
+    };
+
+    std::array<Counter, MAX_GUILD_BAN_COUNTERS> _counters;
+    std::array<GuildBanHistogram, MAX_GUILD_BAN_TIMERS> _timers;
+};
+
+// Records the lifetime of the scope into one of the histograms
+class GuildBanScopedTimer
+{
+public:
+    GuildBanScopedTimer(GuildBanStats& stats, GuildBanTimer timer, bool enabled = true)
+        : _stats(enabled ? &stats : nullptr), _timer(timer)
+    {
+        if (_stats)
+            _start = std::chrono::steady_clock::now();
+    }
+
+    ~GuildBanScopedTimer()
+    {
+        if (_stats)
+            _stats->Record(_timer, std::chrono::steady_clock::now() - _start);
+    }
+
+    GuildBanScopedTimer(GuildBanScopedTimer const&) = delete;
+    GuildBanScopedTimer& operator=(GuildBanScopedTimer const&) = delete;
+
+private:
+    GuildBanStats* _stats;
+    GuildBanTimer _timer;
+    std::chrono::steady_clock::time_point _start;
+};
+
+// Short human readable form of a duration in nanoseconds
+inline std::string FormatGuildBanLatency(uint64 nanoseconds)
+{
+    if (nanoseconds < 10000)
+        return std::to_string(nanoseconds) + " ns";
+
+    if (nanoseconds < 10000000)
+        return std::to_string(nanoseconds / 1000) + " us";
+
+    if (nanoseconds < 10000000000)
+        return std::to_string(nanoseconds / 1000000) + " ms";
+
+    return std::to_string(nanoseconds / 1000000000) + " s";
+}
+
+#endif // _GUILD_BAN_STATS_H_
@@ -0,0 +1,412 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GuildBanStore.h"
+#include <algorithm>
+
+uint32 GuildBanStringPool::Intern(std::string_view str)
+{
+    auto it = _lookup.find(str);
+    if (it != _lookup.end())
+    {
+        ++_refs[it->second];
+        return it->second;
+    }
+
+    uint32 id;
+    if (!_freeIds.empty())
+    {
+        id = _freeIds.back();
+        _freeIds.pop_back();
+        _strings[id].assign(str);
+        _refs[id] = 1;
+    }
+    else
+    {
+        id = _strings.size();
+        _strings.emplace_back(str);
+        _refs.push_back(1);
+    }
+
+    _lookup.emplace(_strings[id], id);
+    return id;
+}
+
+void GuildBanStringPool::Release(uint32 id)
+{
+    if (--_refs[id])
+        return;
+
+    _lookup.erase(_strings[id]);
+    std::string().swap(_strings[id]);
+    _freeIds.push_back(id);
+}
+
+std::size_t GuildBanStringPool::MemoryUsage() const
+{
+    std::size_t total = _strings.size() * sizeof(std::string) + _refs.capacity() * sizeof(uint32) +
+        _freeIds.capacity() * sizeof(uint32) + _lookup.size() * (sizeof(std::string_view) + sizeof(uint32) + 2 * sizeof(void*)) +
+        _lookup.bucket_count() * sizeof(void*);
+
+    for (std::string const& str : _strings)
+        if (str.capacity() > 15)
+            total += str.capacity() + 1;
+
+    return total;
+}
+
+Optional<GuildBanEntry> GuildBanStore::Find(uint32 guildId, uint32 guid) const
+{
+    uint32 const* slot = _keys.Find(MakeGuildBanKey(guildId, guid));
+    if (!slot)
+        return {};
+
+    return GetEntry(*slot);
+}
+
+GuildBanEntry GuildBanStore::GetEntry(uint32 slot) const
+{
+    GuildBanRecord const& record = _records[slot];
+    GuildBanRecordDetails const& details = _details[slot];
+
+    return { record.guildId, record.guid, record.accountId, details.banDate, record.unbanDate,
+        _strings.Get(details.bannedById), _strings.Get(details.reasonId), static_cast<GuildBanType>(record.banType) };
+}
+
+void GuildBanStore::Set(GuildBanInfo const& info, GuildBanIndex::Writer& writer)
+{
+    uint64 key = MakeGuildBanKey(info.guildId, info.guid);
+
+    GuildBanRecord record = { info.guildId, info.guid, info.accountId, info.unbanDate, static_cast<uint8>(info.banType) };
+    uint32 bannedById = _strings.Intern(info.bannedBy);
+    uint32 reasonId = _strings.Intern(info.banReason);
+
+    if (uint32 const* existing = _keys.Find(key))
+    {
+        uint32 slot = *existing;
+        GuildBanRecordDetails& details = _details[slot];
+
+        ReleaseAccountRef(_records[slot], writer);
+        UnlinkAccount(slot);
+        _strings.Release(details.bannedById);
+        _strings.Release(details.reasonId);
+
+        _records[slot] = record;
+        details.banDate = info.banDate;
+        details.bannedById = bannedById;
+        details.reasonId = reasonId;
+
+        LinkAccount(slot);
+        AddAccountRef(record, writer);
+        return;
+    }
+
+    uint32 slot;
+    if (!_freeSlots.empty())
+    {
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+    else
+    {
+        slot = _records.size();
+        _records.emplace_back();
+        _details.emplace_back();
+        _links.emplace_back();
+    }
+
+    std::vector<uint32>& guildSlots = _guilds[info.guildId];
+
+    _records[slot] = record;
+    _details[slot] = { info.banDate, bannedById, reasonId, uint32(guildSlots.size()) };
+    guildSlots.push_back(slot);
+
+    _keys.FindOrInsert(key) = slot;
+    writer.InsertCharacter(key);
+    AddAccountRef(record, writer);
+
+    Link(_guidHeads, info.guid, slot, &GuildBanRecordLinks::prevByGuid, &GuildBanRecordLinks::nextByGuid);
+    LinkAccount(slot);
+}
+
+bool GuildBanStore::SetDetails(GuildBanInfo const& info)
+{
+    uint32 const* slot = _keys.Find(MakeGuildBanKey(info.guildId, info.guid));
+    if (!slot)
+        return false;
+
+    GuildBanRecord const& record = _records[*slot];
+    if (record.accountId != info.accountId || record.unbanDate != info.unbanDate || record.banType != info.banType)
+        return false;
+
+    GuildBanRecordDetails& details = _details[*slot];
+    uint32 bannedById = _strings.Intern(info.bannedBy);
+    uint32 reasonId = _strings.Intern(info.banReason);
+
+    _strings.Release(details.bannedById);
+    _strings.Release(details.reasonId);
+
+    details.banDate = info.banDate;
+    details.bannedById = bannedById;
+    details.reasonId = reasonId;
+    return true;
+}
+
+void GuildBanStore::ClearDetails(uint32 slot)
+{
+    GuildBanRecordDetails& details = _details[slot];
+    uint32 emptyId = _strings.Intern("");
+    _strings.Intern("");
+
+    _strings.Release(details.bannedById);
+    _strings.Release(details.reasonId);
+
+    details.banDate = 0;
+    details.bannedById = emptyId;
+    details.reasonId = emptyId;
+}
+
+bool GuildBanStore::Erase(uint32 guildId, uint32 guid, GuildBanIndex::Writer& writer)
+{
+    uint64 key = MakeGuildBanKey(guildId, guid);
+
+    uint32 const* found = _keys.Find(key);
+    if (!found)
+        return false;
+
+    uint32 slot = *found;
+    _keys.Erase(key);
+    writer.EraseCharacter(key);
+
+    GuildBanRecordDetails& details = _details[slot];
+    ReleaseAccountRef(_records[slot], writer);
+    Unlink(_guidHeads, guid, slot, &GuildBanRecordLinks::prevByGuid, &GuildBanRecordLinks::nextByGuid);
+    UnlinkAccount(slot);
+    _strings.Release(details.bannedById);
+    _strings.Release(details.reasonId);
+
+    // Swap-remove from the guild's slot list, dropping the list with its last ban
+    auto guildIt = _guilds.find(guildId);
+    std::vector<uint32>& guildSlots = guildIt->second;
+    uint32 moved = guildSlots.back();
+    guildSlots[details.guildPos] = moved;
+    _details[moved].guildPos = details.guildPos;
+    guildSlots.pop_back();
+
+    if (guildSlots.empty())
+        _guilds.erase(guildIt);
+
+    _records[slot] = {};
+    _freeSlots.push_back(slot);
+    return true;
+}
+
+std::vector<uint32> const* GuildBanStore::GetGuildSlots(uint32 guildId) const
+{
+    auto it = _guilds.find(guildId);
+    return it != _guilds.end() ? &it->second : nullptr;
+}
+
+std::vector<uint32> GuildBanStore::GetGuildIds() const
+{
+    std::vector<uint32> guildIds;
+    guildIds.reserve(_guilds.size());
+
+    for (auto const& [guildId, slots] : _guilds)
+        guildIds.push_back(guildId);
+
+    return guildIds;
+}
+
+uint32 GuildBanStore::EraseGuild(uint32 guildId, GuildBanIndex::Writer& writer)
+{
+    auto it = _guilds.find(guildId);
+    if (it == _guilds.end())
+        return 0;
+
+    // Erase() drops the slot list with the last ban, work on a copy
+    std::vector<uint32> slots = it->second;
+    for (uint32 slot : slots)
+        Erase(guildId, _records[slot].guid, writer);
+
+    return slots.size();
+}
+
+void GuildBanStore::Reserve(std::size_t count)
+{
+    _records.reserve(count);
+    _details.reserve(count);
+    _links.reserve(count);
+    _keys.Reserve(count);
+}
+
+void GuildBanStore::Link(GuildBanKeyMap& heads, uint32 id, uint32 slot, LinkMember prev, LinkMember next)
+{
+    uint32& head = heads.FindOrInsert(id, NoSlot);
+
+    _links[slot].*prev = NoSlot;
+    _links[slot].*next = head;
+
+    if (head != NoSlot)
+        _links[head].*prev = slot;
+
+    head = slot;
+}
+
+void GuildBanStore::Unlink(GuildBanKeyMap& heads, uint32 id, uint32 slot, LinkMember prev, LinkMember next)
+{
+    GuildBanRecordLinks const& links = _links[slot];
+
+    if (links.*next != NoSlot)
+        _links[links.*next].*prev = links.*prev;
+
+    if (links.*prev != NoSlot)
+        _links[links.*prev].*next = links.*next;
+    else if (links.*next != NoSlot)
+        *heads.Find(id) = links.*next;
+    else
+        heads.Erase(id);
+}
+
+// Account id 0 (unknown account) is not indexed
+void GuildBanStore::LinkAccount(uint32 slot)
+{
+    if (uint32 accountId = _records[slot].accountId)
+        Link(_accountHeads, accountId, slot, &GuildBanRecordLinks::prevByAccount, &GuildBanRecordLinks::nextByAccount);
+}
+
+void GuildBanStore::UnlinkAccount(uint32 slot)
+{
+    if (uint32 accountId = _records[slot].accountId)
+        Unlink(_accountHeads, accountId, slot, &GuildBanRecordLinks::prevByAccount, &GuildBanRecordLinks::nextByAccount);
+}
+
+std::size_t GuildBanStore::MemoryUsage() const
+{
+    std::size_t total = _records.capacity() * sizeof(GuildBanRecord) + _details.capacity() * sizeof(GuildBanRecordDetails) +
+        _links.capacity() * sizeof(GuildBanRecordLinks) + _freeSlots.capacity() * sizeof(uint32) + _keys.MemoryUsage() +
+        _accountRefs.MemoryUsage() + _guidHeads.MemoryUsage() + _accountHeads.MemoryUsage() + _strings.MemoryUsage() +
+        _guilds.bucket_count() * sizeof(void*);
+
+    for (auto const& [guildId, slots] : _guilds)
+        total += sizeof(guildId) + sizeof(slots) + 2 * sizeof(void*) + slots.capacity() * sizeof(uint32);
+
+    return total;
+}
+
+void GuildBanStore::AddAccountRef(GuildBanRecord const& record, GuildBanIndex::Writer& writer)
+{
+    if (record.banType != GUILD_BAN_ACCOUNT || !record.accountId)
+        return;
+
+    uint64 key = MakeGuildBanKey(record.guildId, record.accountId);
+    if (!_accountRefs.FindOrInsert(key)++)
+        writer.InsertAccount(key);
+}
+
+void GuildBanStore::ReleaseAccountRef(GuildBanRecord const& record, GuildBanIndex::Writer& writer)
+{
+    if (record.banType != GUILD_BAN_ACCOUNT || !record.accountId)
+        return;
+
+    uint64 key = MakeGuildBanKey(record.guildId, record.accountId);
+    uint32* refs = _accountRefs.Find(key);
+    if (refs && !--*refs)
+    {
+        _accountRefs.Erase(key);
+        writer.EraseAccount(key);
+    }
+}
+
+uint32 GuildBanStore::GetGuildPage(uint32 guildId, uint32 offset, uint32 limit, GuildBanSortOrder order,
+                                   std::vector<GuildBanEntry>& page) const
+{
+    page.clear();
+
+    std::vector<uint32> const* slots = GetGuildSlots(guildId);
+    if (!slots)
+        return 0;
+
+    uint32 total = slots->size();
+
+    if (offset >= total)
+        return total;
+
+    uint32 end = std::min<uint64>(uint64(offset) + limit, total);
+
+    if (order == GUILD_BAN_SORT_NONE)
+    {
+        for (uint32 i = offset; i < end; ++i)
+            page.push_back(GetEntry((*slots)[i]));
+
+        return total;
+    }
+
+    // Sort slot ids only, and only as far as the requested page reaches
+    std::vector<uint32> sorted(*slots);
+
+    auto compare = [this, order](uint32 leftSlot, uint32 rightSlot)
+    {
+        GuildBanRecord const& left = GetRecord(leftSlot);
+        GuildBanRecord const& right = GetRecord(rightSlot);
+
+        switch (order)
+        {
+            case GUILD_BAN_SORT_TYPE:
+                if (left.banType != right.banType)
+                    return left.banType > right.banType; // account bans first
+                break;
+            case GUILD_BAN_SORT_EXPIRY:
+                // Soonest expiry first, permanent bans last
+                return (left.unbanDate ? left.unbanDate : UINT32_MAX) < (right.unbanDate ? right.unbanDate : UINT32_MAX);
+            default:
+                break;
+        }
+
+        return GetDetails(leftSlot).banDate > GetDetails(rightSlot).banDate; // newest first
+    };
+
+    std::partial_sort(sorted.begin(), sorted.begin() + end, sorted.end(), compare);
+
+    for (uint32 i = offset; i < end; ++i)
+        page.push_back(GetEntry(sorted[i]));
+
+    return total;
+}
+
+uint32 GuildBanStore::Load(std::vector<std::vector<GuildBanInfo>> const& parts, GuildBanIndex::Writer& writer,
+                           std::vector<GuildBanExpiry>& expiries)
+{
+    uint32 count = 0;
+    for (std::vector<GuildBanInfo> const& part : parts)
+        count += part.size();
+
+    Reserve(count);
+
+    for (std::vector<GuildBanInfo> const& part : parts)
+    {
+        for (GuildBanInfo const& info : part)
+        {
+            if (info.unbanDate)
+                expiries.push_back({ info.unbanDate, info.guildId, info.guid });
+
+            Set(info, writer);
+        }
+    }
+
+    return count;
+}
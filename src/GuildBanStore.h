@@ -0,0 +1,224 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GUILD_BAN_STORE_H_
+#define _GUILD_BAN_STORE_H_
+
+#include "Define.h"
+#include "GuildBanIndex.h"
+#include "Optional.h"
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum GuildBanType
+{
+    GUILD_BAN_CHARACTER = 0,
+    GUILD_BAN_ACCOUNT   = 1
+};
+
+struct GuildBanInfo
+{
+    uint32 guildId;
+    uint32 guid;
+    uint32 accountId;
+    uint32 banDate;
+    uint32 unbanDate;
+    std::string bannedBy;
+    std::string banReason;
+    GuildBanType banType;
+};
+
+// Read-only view of a stored ban. The strings point into the store's string pool
+// and, like the view itself, are valid until the next ban change.
+struct GuildBanEntry
+{
+    uint32 guildId;
+    uint32 guid;
+    uint32 accountId;
+    uint32 banDate;
+    uint32 unbanDate;
+    std::string_view bannedBy;
+    std::string_view banReason;
+    GuildBanType banType;
+};
+
+inline bool IsSameGuildBan(GuildBanEntry const& ban, GuildBanInfo const& info)
+{
+    return ban.accountId == info.accountId && ban.banDate == info.banDate && ban.unbanDate == info.unbanDate &&
+        ban.banType == info.banType && ban.bannedBy == info.bannedBy && ban.banReason == info.banReason;
+}
+
+enum GuildBanSortOrder : uint8
+{
+    GUILD_BAN_SORT_NONE   = 0,
+    GUILD_BAN_SORT_DATE   = 1, // newest first
+    GUILD_BAN_SORT_TYPE   = 2, // account bans first, then newest
+    GUILD_BAN_SORT_EXPIRY = 3  // soonest expiry first, permanent last
+};
+
+// Pending expiry of a temporary ban, ordered by unbanDate
+struct GuildBanExpiry
+{
+    uint32 unbanDate;
+    uint32 guildId;
+    uint32 guid;
+
+    bool operator>(GuildBanExpiry const& right) const { return unbanDate > right.unbanDate; }
+};
+
+// Reference counted interning of the officer names and reasons shared by many bans
+class GuildBanStringPool
+{
+public:
+    uint32 Intern(std::string_view str);
+    void Release(uint32 id);
+    std::string_view Get(uint32 id) const { return _strings[id]; }
+
+    std::size_t Size() const { return _lookup.size(); }
+    std::size_t MemoryUsage() const;
+
+private:
+    // deque keeps the strings in place, the lookup keys are views into them
+    std::deque<std::string> _strings;
+    std::vector<uint32> _refs;
+    std::vector<uint32> _freeIds;
+    std::unordered_map<std::string_view, uint32> _lookup;
+};
+
+// Fields read when checking expiry and sorting listings
+struct GuildBanRecord
+{
+    uint32 guildId;
+    uint32 guid;
+    uint32 accountId;
+    uint32 unbanDate;
+    uint8 banType;
+};
+
+// Fields only needed to display or save a ban
+struct GuildBanRecordDetails
+{
+    uint32 banDate;
+    uint32 bannedById;
+    uint32 reasonId;
+    uint32 guildPos; // position of the slot in its guild's slot list
+};
+
+// Links of a slot into the per-character and per-account lists of the reverse indexes
+struct GuildBanRecordLinks
+{
+    uint32 prevByGuid;
+    uint32 nextByGuid;
+    uint32 prevByAccount;
+    uint32 nextByAccount;
+};
+
+// Ban records in a slot arena, indexed by (guildId, guid) and grouped per guild.
+// Set, Erase and Find are O(1); there is at most one record per primary key, like in guild_bans.
+// Guild slot lists are dropped with their last ban.
+class GuildBanStore
+{
+public:
+    Optional<GuildBanEntry> Find(uint32 guildId, uint32 guid) const;
+    // Inserts or replaces the ban of (info.guildId, info.guid) and mirrors key changes into the index
+    void Set(GuildBanInfo const& info, GuildBanIndex::Writer& writer);
+    // Replaces banDate, bannedBy and banReason of the ban matching the other fields of info, false if there is none
+    bool SetDetails(GuildBanInfo const& info);
+    // Drops banDate, bannedBy and banReason, the ban itself stays
+    void ClearDetails(uint32 slot);
+    bool Erase(uint32 guildId, uint32 guid, GuildBanIndex::Writer& writer);
+
+    // Slots holding the bans of one guild, nullptr when the guild has none
+    std::vector<uint32> const* GetGuildSlots(uint32 guildId) const;
+    std::vector<uint32> GetGuildIds() const;
+    // Removes every ban of the guild and returns how many there were
+    uint32 EraseGuild(uint32 guildId, GuildBanIndex::Writer& writer);
+    GuildBanRecord const& GetRecord(uint32 slot) const { return _records[slot]; }
+    GuildBanRecordDetails const& GetDetails(uint32 slot) const { return _details[slot]; }
+    GuildBanEntry GetEntry(uint32 slot) const;
+    // Fills page with the guild's bans [offset, offset + limit) in the given order and returns
+    // the guild's total ban count
+    uint32 GetGuildPage(uint32 guildId, uint32 offset, uint32 limit, GuildBanSortOrder order,
+                        std::vector<GuildBanEntry>& page) const;
+    // Fills an empty store with the partitions of a full load and appends its temporary bans
+    // to expiries; returns the number of bans
+    uint32 Load(std::vector<std::vector<GuildBanInfo>> const& parts, GuildBanIndex::Writer& writer,
+                std::vector<GuildBanExpiry>& expiries);
+
+    template<typename Callback>
+    void ForEach(Callback&& callback) const
+    {
+        for (auto const& [guildId, slots] : _guilds)
+            for (uint32 slot : slots)
+                callback(GetEntry(slot));
+    }
+
+    // Bans of one character in any guild
+    template<typename Callback>
+    void ForEachOfCharacter(uint32 guid, Callback&& callback) const
+    {
+        uint32 const* head = _guidHeads.Find(guid);
+        for (uint32 slot = head ? *head : NoSlot; slot != NoSlot; slot = _links[slot].nextByGuid)
+            callback(GetEntry(slot));
+    }
+
+    // Bans recorded with this account in any guild, character and account bans alike
+    template<typename Callback>
+    void ForEachOfAccount(uint32 accountId, Callback&& callback) const
+    {
+        uint32 const* head = accountId ? _accountHeads.Find(accountId) : nullptr;
+        for (uint32 slot = head ? *head : NoSlot; slot != NoSlot; slot = _links[slot].nextByAccount)
+            callback(GetEntry(slot));
+    }
+
+    uint32 Size() const { return _keys.Size(); }
+    void Reserve(std::size_t count);
+    std::size_t MemoryUsage() const;
+
+private:
+    void AddAccountRef(GuildBanRecord const& record, GuildBanIndex::Writer& writer);
+    void ReleaseAccountRef(GuildBanRecord const& record, GuildBanIndex::Writer& writer);
+
+    using LinkMember = uint32 GuildBanRecordLinks::*;
+    void Link(GuildBanKeyMap& heads, uint32 id, uint32 slot, LinkMember prev, LinkMember next);
+    void Unlink(GuildBanKeyMap& heads, uint32 id, uint32 slot, LinkMember prev, LinkMember next);
+    void LinkAccount(uint32 slot);
+    void UnlinkAccount(uint32 slot);
+
+    static constexpr uint32 NoSlot = UINT32_MAX;
+
+    // Parallel slot arrays
+    std::vector<GuildBanRecord> _records;
+    std::vector<GuildBanRecordDetails> _details;
+    std::vector<GuildBanRecordLinks> _links;
+    std::vector<uint32> _freeSlots;
+    GuildBanStringPool _strings;
+    // (guildId << 32 | guid) -> slot
+    GuildBanKeyMap _keys;
+    // (guildId << 32 | accountId) -> number of account bans on that account
+    GuildBanKeyMap _accountRefs;
+    // guildId -> slots of the guild's bans
+    std::unordered_map<uint32, std::vector<uint32>> _guilds;
+    // guid / accountId -> first slot of its list in _links
+    GuildBanKeyMap _guidHeads;
+    GuildBanKeyMap _accountHeads;
+};
+
+#endif // _GUILD_BAN_STORE_H_
@@ -19,12 +19,20 @@
 #include "Chat.h"
 #include "CharacterCache.h"
 #include "CommandScript.h"
+#include "DatabaseEnv.h"
 #include "Guild.h"
 #include "GuildMgr.h"
+#include "ObjectAccessor.h"
 #include "ObjectMgr.h"
 #include "Player.h"
+#include "WorldPacket.h"
 #include "WorldSession.h"
 #include "Timer.h"
+#include "Util.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
 
 using namespace Acore::ChatCommands;
 
@@ -35,12 +43,30 @@ public:
 
     ChatCommandTable GetCommands() const override
     {
+        static ChatCommandTable gbanSharedCommandTable =
+        {
+            { "create",     HandleGbanSharedCreateCommand, SEC_PLAYER,   Console::No },
+            { "delete",     HandleGbanSharedDeleteCommand, SEC_PLAYER,   Console::No },
+            { "add",        HandleGbanSharedAddCommand,    SEC_PLAYER,   Console::No },
+            { "remove",     HandleGbanSharedRemoveCommand, SEC_PLAYER,   Console::No },
+        };
+
         static ChatCommandTable gbanCommandTable =
         {
             { "character",  HandleGbanCharacterCommand,  SEC_PLAYER,     Console::No },
             { "account",    HandleGbanAccountCommand,    SEC_PLAYER,     Console::No },
             { "remove",     HandleGbanRemoveCommand,     SEC_PLAYER,     Console::No },
             { "list",       HandleGbanListCommand,       SEC_PLAYER,     Console::No },
+            { "history",    HandleGbanHistoryCommand,    SEC_PLAYER,     Console::No },
+            { "shared",     gbanSharedCommandTable },
+            { "subscribe",  HandleGbanSubscribeCommand,  SEC_PLAYER,     Console::No },
+            { "unsubscribe", HandleGbanUnsubscribeCommand, SEC_PLAYER,   Console::No },
+            { "bulk",       HandleGbanBulkCommand,       SEC_PLAYER,     Console::No },
+            { "import",     HandleGbanImportCommand,     SEC_ADMINISTRATOR, Console::Yes },
+            { "lookup",     HandleGbanLookupCommand,     SEC_GAMEMASTER, Console::Yes },
+            { "stats",      HandleGbanStatsCommand,      SEC_GAMEMASTER, Console::Yes },
+            { "reload",     HandleGbanReloadCommand,     SEC_GAMEMASTER, Console::Yes },
+            { "verify",     HandleGbanVerifyCommand,     SEC_GAMEMASTER, Console::Yes },
         };
 
         static ChatCommandTable commandTable =
@@ -86,7 +112,47 @@ public:
         return true;
     }
 
-    static bool HandleGbanCharacterCommand(ChatHandler* handler, Optional<PlayerIdentifier> target, Optional<std::string> reason)
+    // A duration is digits followed by d/h/m/s units, e.g. 30m, 7d or 1d12h
+    static bool IsDurationToken(std::string_view token)
+    {
+        auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+
+        if (token.empty() || !isDigit(token.front()) || isDigit(token.back()))
+            return false;
+
+        for (char c : token)
+        {
+            if (!isDigit(c) && c != 'd' && c != 'h' && c != 'm' && c != 's')
+                return false;
+        }
+
+        return true;
+    }
+
+    // Splits "[duration] [reason]"; the first word is only taken as a duration if it looks like one
+    static void ParseBanArgs(std::string_view args, uint32& duration, std::string& reason)
+    {
+        duration = 0;
+
+        std::string_view first = args.substr(0, args.find(' '));
+        if (IsDurationToken(first))
+        {
+            duration = TimeStringToSecs(std::string(first));
+            args.remove_prefix(first.size());
+
+            while (!args.empty() && args.front() == ' ')
+                args.remove_prefix(1);
+        }
+
+        reason = args.empty() ? "No reason specified" : std::string(args);
+    }
+
+    static std::string FormatBanDuration(uint32 duration)
+    {
+        return duration ? secsToTimeString(duration) : "permanent";
+    }
+
+    static bool HandleGbanCharacterCommand(ChatHandler* handler, Optional<PlayerIdentifier> target, Tail args)
     {
         Player* admin = handler->GetSession()->GetPlayer();
         if (!admin)
@@ -139,33 +205,32 @@ public:
             return false;
         }
 
-        std::string banReason = reason.value_or("No reason specified");
+        uint32 duration;
+        std::string banReason;
+        ParseBanArgs(args, duration, banReason);
 
         // Add to ban list
         sGuildBanMgr->AddBan(guild->GetId(), targetGuid.GetCounter(), targetAccountId,
-                            admin->GetName(), banReason, 0, GUILD_BAN_CHARACTER);
+                            admin->GetName(), banReason, duration, GUILD_BAN_CHARACTER);
 
         // Kick from guild if member
-        if (guild->GetMember(targetGuid))
-        {
-            guild->DeleteMember(targetGuid, false, true, false);
-        }
+        sGuildBanMgr->RemoveGuildMembers(guild, { &targetGuid, 1 });
 
-        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Character %s has been banned from the guild. Reason: %s",
-                                 targetName.c_str(), banReason.c_str());
+        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Character %s has been banned from the guild (%s). Reason: %s",
+                                 targetName.c_str(), FormatBanDuration(duration).c_str(), banReason.c_str());
 
         // Notify the banned player if online
         if (target->IsConnected())
         {
             ChatHandler(target->GetConnectedPlayer()->GetSession()).PSendSysMessage(
-                "|cffff0000[Guild Ban]|r You have been banned from <%s>. Reason: %s",
-                guild->GetName().c_str(), banReason.c_str());
+                "|cffff0000[Guild Ban]|r You have been banned from <%s> (%s). Reason: %s",
+                guild->GetName().c_str(), FormatBanDuration(duration).c_str(), banReason.c_str());
         }
 
         return true;
     }
 
-    static bool HandleGbanAccountCommand(ChatHandler* handler, Optional<PlayerIdentifier> target, Optional<std::string> reason)
+    static bool HandleGbanAccountCommand(ChatHandler* handler, Optional<PlayerIdentifier> target, Tail args)
     {
         Player* admin = handler->GetSession()->GetPlayer();
         if (!admin)
@@ -224,46 +289,42 @@ public:
             return false;
         }
 
-        std::string banReason = reason.value_or("No reason specified");
+        uint32 duration;
+        std::string banReason;
+        ParseBanArgs(args, duration, banReason);
 
         // Add to ban list (account-wide)
         sGuildBanMgr->AddBan(guild->GetId(), targetGuid.GetCounter(), targetAccountId,
-                            admin->GetName(), banReason, 0, GUILD_BAN_ACCOUNT);
+                            admin->GetName(), banReason, duration, GUILD_BAN_ACCOUNT);
 
-        // Kick from guild if member
-        if (guild->GetMember(targetGuid))
+        // Kick the target and every other character of the account in one batch,
+        // from the account cache when possible
+        sGuildBanMgr->GetAccountCharacters(targetAccountId, [guildId = guild->GetId(), targetGuid](std::vector<uint32> const& guids)
         {
-            guild->DeleteMember(targetGuid, false, true, false);
-        }
+            Guild* guild = sGuildMgr->GetGuildById(guildId);
+            if (!guild)
+                return;
 
-        // Also kick all other characters from the same account
-        QueryResult result = CharacterDatabase.Query(
-            "SELECT guid FROM characters WHERE account = {} AND guid != {}",
-            targetAccountId, targetGuid.GetCounter());
-
-        if (result)
-        {
-            do
+            std::vector<ObjectGuid> members = { targetGuid };
+            for (uint32 charGuid : guids)
             {
-                uint32 charGuid = result->Fetch()[0].Get<uint32>();
                 ObjectGuid altGuid = ObjectGuid::Create<HighGuid::Player>(charGuid);
+                if (altGuid != targetGuid && guild->GetMember(altGuid))
+                    members.push_back(altGuid);
+            }
 
-                if (guild->GetMember(altGuid))
-                {
-                    guild->DeleteMember(altGuid, false, true, false);
-                }
-            } while (result->NextRow());
-        }
+            sGuildBanMgr->RemoveGuildMembers(guild, members);
+        });
 
-        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Account of %s has been banned from the guild (all characters). Reason: %s",
-                                 targetName.c_str(), banReason.c_str());
+        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Account of %s has been banned from the guild (all characters, %s). Reason: %s",
+                                 targetName.c_str(), FormatBanDuration(duration).c_str(), banReason.c_str());
 
         // Notify the banned player if online
         if (target->IsConnected())
         {
             ChatHandler(target->GetConnectedPlayer()->GetSession()).PSendSysMessage(
-                "|cffff0000[Guild Ban]|r Your account has been banned from <%s>. Reason: %s",
-                guild->GetName().c_str(), banReason.c_str());
+                "|cffff0000[Guild Ban]|r Your account has been banned from <%s> (%s). Reason: %s",
+                guild->GetName().c_str(), FormatBanDuration(duration).c_str(), banReason.c_str());
         }
 
         return true;
@@ -303,14 +364,478 @@ public:
             return false;
         }
 
-        sGuildBanMgr->RemoveBan(guild->GetId(), targetGuid.GetCounter());
+        sGuildBanMgr->RemoveBan(guild->GetId(), targetGuid.GetCounter(), admin->GetName());
 
         handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Ban removed for player %s.", targetName.c_str());
 
         return true;
     }
 
-    static bool HandleGbanListCommand(ChatHandler* handler)
+    // Player's guild when the player may manage its bans, otherwise reports why not
+    static Guild* GetBanningGuild(ChatHandler* handler)
+    {
+        Player* admin = handler->GetSession()->GetPlayer();
+        if (!admin)
+            return nullptr;
+
+        Guild* guild = admin->GetGuild();
+        if (!guild)
+        {
+            handler->SendErrorMessage("You are not in a guild.");
+            return nullptr;
+        }
+
+        return CanBan(handler, guild, admin) ? guild : nullptr;
+    }
+
+    static GuildBanList const* FindSharedList(ChatHandler* handler, std::string_view name)
+    {
+        GuildBanList const* list = sGuildBanMgr->GetSharedList(name);
+        if (!list)
+            handler->SendErrorMessage("There is no shared ban list named %s.", std::string(name).c_str());
+
+        return list;
+    }
+
+    // Shared list that the player's guild owns
+    static GuildBanList const* FindOwnedSharedList(ChatHandler* handler, Guild* guild, std::string_view name)
+    {
+        GuildBanList const* list = FindSharedList(handler, name);
+        if (list && list->ownerGuildId != guild->GetId())
+        {
+            handler->SendErrorMessage("Shared ban list %s is maintained by another guild.", list->name.c_str());
+            return nullptr;
+        }
+
+        return list;
+    }
+
+    // .gban shared create <list>
+    static bool HandleGbanSharedCreateCommand(ChatHandler* handler, std::string_view name)
+    {
+        Guild* guild = GetBanningGuild(handler);
+        if (!guild)
+            return false;
+
+        bool valid = !name.empty() && name.size() <= MaxSharedListNameLength &&
+            std::all_of(name.begin(), name.end(), [](char c) { return std::isalnum(uint8(c)) || c == '_' || c == '-'; });
+
+        if (!valid)
+        {
+            handler->SendErrorMessage("List names are up to %u letters, digits, '_' or '-'.", MaxSharedListNameLength);
+            return false;
+        }
+
+        GuildBanList const* list = sGuildBanMgr->CreateSharedList(name, guild->GetId());
+        if (!list)
+        {
+            handler->SendErrorMessage("A shared ban list named %s already exists.", std::string(name).c_str());
+            return false;
+        }
+
+        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Created shared ban list %s. Guilds use it with .gban subscribe %s",
+                                 list->name.c_str(), list->name.c_str());
+        return true;
+    }
+
+    // .gban shared delete <list>
+    static bool HandleGbanSharedDeleteCommand(ChatHandler* handler, std::string_view name)
+    {
+        Guild* guild = GetBanningGuild(handler);
+        if (!guild)
+            return false;
+
+        GuildBanList const* list = FindOwnedSharedList(handler, guild, name);
+        if (!list)
+            return false;
+
+        std::string listName = list->name;
+        sGuildBanMgr->DeleteSharedList(list->id);
+
+        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Deleted shared ban list %s.", listName.c_str());
+        return true;
+    }
+
+    // .gban shared add <list> <character|account> <player> [duration] [reason]
+    static bool HandleGbanSharedAddCommand(ChatHandler* handler, std::string_view name, std::string_view type,
+                                           PlayerIdentifier target, Tail args)
+    {
+        Guild* guild = GetBanningGuild(handler);
+        if (!guild)
+            return false;
+
+        GuildBanList const* list = FindOwnedSharedList(handler, guild, name);
+        if (!list)
+            return false;
+
+        GuildBanType banType;
+        if (type == "character")
+            banType = GUILD_BAN_CHARACTER;
+        else if (type == "account")
+            banType = GUILD_BAN_ACCOUNT;
+        else
+        {
+            handler->SendErrorMessage("Usage: .gban shared add <list> <character|account> <player> [duration] [reason]");
+            return false;
+        }
+
+        Player* admin = handler->GetSession()->GetPlayer();
+        if (target.GetGUID() == admin->GetGUID())
+        {
+            handler->SendErrorMessage("You cannot ban yourself.");
+            return false;
+        }
+
+        uint32 targetAccountId = sCharacterCache->GetCharacterAccountIdByGuid(target.GetGUID());
+        if (banType == GUILD_BAN_ACCOUNT && !targetAccountId)
+        {
+            handler->SendErrorMessage("Could not find account for player.");
+            return false;
+        }
+
+        uint32 duration;
+        std::string banReason;
+        ParseBanArgs(args, duration, banReason);
+
+        sGuildBanMgr->AddBan(MakeGuildBanListGuildId(list->id), target.GetGUID().GetCounter(), targetAccountId,
+                             admin->GetName(), banReason, duration, banType);
+
+        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r %s %s added to shared ban list %s (%s). Reason: %s",
+                                 banType == GUILD_BAN_ACCOUNT ? "Account of" : "Character", target.GetName().c_str(),
+                                 list->name.c_str(), FormatBanDuration(duration).c_str(), banReason.c_str());
+        return true;
+    }
+
+    // .gban shared remove <list> <player>
+    static bool HandleGbanSharedRemoveCommand(ChatHandler* handler, std::string_view name, PlayerIdentifier target)
+    {
+        Guild* guild = GetBanningGuild(handler);
+        if (!guild)
+            return false;
+
+        GuildBanList const* list = FindOwnedSharedList(handler, guild, name);
+        if (!list)
+            return false;
+
+        if (!sGuildBanMgr->RemoveBan(MakeGuildBanListGuildId(list->id), target.GetGUID().GetCounter(),
+                                     handler->GetSession()->GetPlayer()->GetName()))
+        {
+            handler->SendErrorMessage("Player %s is not on shared ban list %s.", target.GetName().c_str(), list->name.c_str());
+            return false;
+        }
+
+        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Player %s removed from shared ban list %s.",
+                                 target.GetName().c_str(), list->name.c_str());
+        return true;
+    }
+
+    // .gban subscribe <list>: the list's bans apply to the guild like its own
+    static bool HandleGbanSubscribeCommand(ChatHandler* handler, std::string_view name)
+    {
+        Guild* guild = GetBanningGuild(handler);
+        if (!guild)
+            return false;
+
+        GuildBanList const* list = FindSharedList(handler, name);
+        if (!list)
+            return false;
+
+        if (sGuildBanMgr->GetSubscriptions(guild->GetId()).size() >= sGuildBanMgr->GetMaxSubscriptions())
+        {
+            handler->SendErrorMessage("Your guild already subscribes to the maximum of %u shared ban lists.",
+                                      sGuildBanMgr->GetMaxSubscriptions());
+            return false;
+        }
+
+        if (!sGuildBanMgr->Subscribe(guild->GetId(), list->id))
+        {
+            handler->SendErrorMessage("Your guild already subscribes to %s.", list->name.c_str());
+            return false;
+        }
+
+        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Your guild now subscribes to shared ban list %s.", list->name.c_str());
+        return true;
+    }
+
+    // .gban unsubscribe <list>
+    static bool HandleGbanUnsubscribeCommand(ChatHandler* handler, std::string_view name)
+    {
+        Guild* guild = GetBanningGuild(handler);
+        if (!guild)
+            return false;
+
+        GuildBanList const* list = FindSharedList(handler, name);
+        if (!list)
+            return false;
+
+        if (!sGuildBanMgr->Unsubscribe(guild->GetId(), list->id))
+        {
+            handler->SendErrorMessage("Your guild does not subscribe to %s.", list->name.c_str());
+            return false;
+        }
+
+        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Your guild no longer subscribes to shared ban list %s.", list->name.c_str());
+        return true;
+    }
+
+    struct BulkBanLine
+    {
+        std::string name;
+        GuildBanType banType;
+        uint32 duration;
+        std::string reason;
+    };
+
+    // .gban bulk <character|account|remove> <name,name,...> [duration] [reason]
+    static bool HandleGbanBulkCommand(ChatHandler* handler, std::string_view action, std::string_view names, Tail args)
+    {
+        Player* admin = handler->GetSession()->GetPlayer();
+        if (!admin)
+            return false;
+
+        Guild* guild = admin->GetGuild();
+        if (!guild)
+        {
+            handler->SendErrorMessage("You are not in a guild.");
+            return false;
+        }
+
+        if (!CanBan(handler, guild, admin))
+            return false;
+
+        if (action == "remove")
+        {
+            std::vector<uint32> guids;
+            std::vector<std::string> unknown;
+
+            for (std::string_view token : Acore::Tokenize(names, ',', false))
+            {
+                std::string name(token);
+                if (!normalizePlayerName(name))
+                    continue;
+
+                if (CharacterCacheEntry const* entry = sCharacterCache->GetCharacterCacheByName(name))
+                    guids.push_back(entry->Guid.GetCounter());
+                else
+                    unknown.push_back(std::move(name));
+            }
+
+            uint32 removed = sGuildBanMgr->RemoveBans(guild->GetId(), guids, admin->GetName());
+
+            handler->SendSysMessage(Acore::StringFormat("|cff00ff00[Guild Ban]|r Removed {} bans.", removed));
+            SendUnknownNames(handler, unknown);
+            return true;
+        }
+
+        GuildBanType banType;
+        if (action == "character")
+            banType = GUILD_BAN_CHARACTER;
+        else if (action == "account")
+            banType = GUILD_BAN_ACCOUNT;
+        else
+        {
+            handler->SendErrorMessage("Usage: .gban bulk <character|account|remove> <name,name,...> [duration] [reason]");
+            return false;
+        }
+
+        uint32 duration;
+        std::string banReason;
+        ParseBanArgs(args, duration, banReason);
+
+        std::vector<BulkBanLine> lines;
+        for (std::string_view token : Acore::Tokenize(names, ',', false))
+            lines.push_back({ std::string(token), banType, duration, banReason });
+
+        ExecuteBulkBan(handler, guild, admin->GetName(), admin->GetGUID(), lines);
+        return true;
+    }
+
+    // .gban import <guildId> <file>
+    // One ban per line: name[,character|account[,duration[,reason]]]; empty lines and lines starting with # are skipped
+    static bool HandleGbanImportCommand(ChatHandler* handler, uint32 guildId, std::string_view fileName)
+    {
+        std::string const& directory = sGuildBanMgr->GetImportDirectory();
+        if (directory.empty())
+        {
+            handler->SendErrorMessage("Guild ban import is disabled, see GuildBan.Import.Directory.");
+            return false;
+        }
+
+        // Only plain file names inside the configured directory
+        if (fileName.empty() || fileName.find_first_of("/\\:") != std::string_view::npos || fileName.find("..") != std::string_view::npos)
+        {
+            handler->SendErrorMessage("Invalid file name.");
+            return false;
+        }
+
+        Guild* guild = sGuildMgr->GetGuildById(guildId);
+        if (!guild)
+        {
+            handler->SendErrorMessage("Guild %u does not exist.", guildId);
+            return false;
+        }
+
+        std::filesystem::path path = std::filesystem::path(directory) / std::string(fileName);
+        std::ifstream file(path);
+        if (!file)
+        {
+            handler->SendErrorMessage("Could not open %s.", path.string().c_str());
+            return false;
+        }
+
+        std::vector<BulkBanLine> lines;
+        uint32 lineNumber = 0;
+
+        for (std::string text; std::getline(file, text);)
+        {
+            ++lineNumber;
+
+            if (!text.empty() && text.back() == '\r')
+                text.pop_back();
+
+            if (text.empty() || text.front() == '#')
+                continue;
+
+            // The reason is the rest of the line and may contain commas itself
+            std::string_view rest = text;
+            auto nextField = [&rest]()
+            {
+                std::string_view field = rest.substr(0, rest.find(','));
+                rest.remove_prefix(std::min(rest.size(), field.size() + 1));
+                return field;
+            };
+
+            BulkBanLine line;
+            line.name = std::string(nextField());
+            std::string_view type = nextField();
+            std::string_view duration = nextField();
+
+            if (type.empty() || type == "character")
+                line.banType = GUILD_BAN_CHARACTER;
+            else if (type == "account")
+                line.banType = GUILD_BAN_ACCOUNT;
+            else
+            {
+                handler->SendErrorMessage("Line %u: unknown ban type '%s'.", lineNumber, std::string(type).c_str());
+                return false;
+            }
+
+            if (!duration.empty() && !IsDurationToken(duration))
+            {
+                handler->SendErrorMessage("Line %u: invalid duration '%s'.", lineNumber, std::string(duration).c_str());
+                return false;
+            }
+
+            line.duration = duration.empty() ? 0 : TimeStringToSecs(std::string(duration));
+            line.reason = rest.empty() ? "No reason specified" : std::string(rest);
+            lines.push_back(std::move(line));
+        }
+
+        std::string bannedBy = handler->GetSession() && handler->GetSession()->GetPlayer() ?
+            handler->GetSession()->GetPlayer()->GetName() : "Console";
+
+        ExecuteBulkBan(handler, guild, bannedBy, ObjectGuid::Empty, lines);
+        return true;
+    }
+
+    // Resolves all names in one pass, bans them with a single index update and transaction,
+    // then removes the banned characters still in the guild
+    static void ExecuteBulkBan(ChatHandler* handler, Guild* guild, std::string const& bannedBy, ObjectGuid adminGuid,
+                               std::vector<BulkBanLine> const& lines)
+    {
+        uint32 now = time(nullptr);
+        std::vector<GuildBanInfo> bans;
+        std::vector<std::string> unknown;
+        uint32 skipped = 0;
+
+        bans.reserve(lines.size());
+
+        for (BulkBanLine const& line : lines)
+        {
+            std::string name = line.name;
+            CharacterCacheEntry const* entry = normalizePlayerName(name) ? sCharacterCache->GetCharacterCacheByName(name) : nullptr;
+
+            if (!entry)
+            {
+                unknown.push_back(std::move(name));
+                continue;
+            }
+
+            // Same rules as the single ban commands
+            if (entry->Guid == adminGuid || entry->Guid == guild->GetLeaderGUID() ||
+                (line.banType == GUILD_BAN_ACCOUNT && !entry->AccountId))
+            {
+                ++skipped;
+                continue;
+            }
+
+            GuildBanInfo info;
+            info.guildId    = guild->GetId();
+            info.guid       = entry->Guid.GetCounter();
+            info.accountId  = entry->AccountId;
+            info.banDate    = now;
+            info.unbanDate  = line.duration ? now + line.duration : 0;
+            info.bannedBy   = bannedBy;
+            info.banReason  = line.reason;
+            info.banType    = line.banType;
+            bans.push_back(std::move(info));
+        }
+
+        sGuildBanMgr->AddBans(bans);
+
+        std::vector<ObjectGuid> members;
+        members.reserve(bans.size());
+
+        for (GuildBanInfo const& ban : bans)
+            members.push_back(ObjectGuid::Create<HighGuid::Player>(ban.guid));
+
+        uint32 kicked = sGuildBanMgr->RemoveGuildMembers(guild, members);
+
+        // Other characters of banned accounts, one batch per account
+        for (GuildBanInfo const& ban : bans)
+        {
+            if (ban.banType != GUILD_BAN_ACCOUNT)
+                continue;
+
+            sGuildBanMgr->GetAccountCharacters(ban.accountId, [guildId = guild->GetId()](std::vector<uint32> const& guids)
+            {
+                Guild* guild = sGuildMgr->GetGuildById(guildId);
+                if (!guild)
+                    return;
+
+                std::vector<ObjectGuid> alts;
+                alts.reserve(guids.size());
+
+                for (uint32 charGuid : guids)
+                    alts.push_back(ObjectGuid::Create<HighGuid::Player>(charGuid));
+
+                sGuildBanMgr->RemoveGuildMembers(guild, alts);
+            });
+        }
+
+        handler->SendSysMessage(Acore::StringFormat("|cff00ff00[Guild Ban]|r Banned {} characters from <{}>, {} removed from the guild, {} skipped.",
+                                                    bans.size(), guild->GetName(), kicked, skipped));
+        SendUnknownNames(handler, unknown);
+    }
+
+    static void SendUnknownNames(ChatHandler* handler, std::vector<std::string> const& unknown)
+    {
+        static constexpr std::size_t MaxListedNames = 20;
+
+        if (unknown.empty())
+            return;
+
+        std::string list;
+        for (std::size_t i = 0; i < std::min(unknown.size(), MaxListedNames); ++i)
+            list += (i ? ", " : "") + unknown[i];
+
+        if (unknown.size() > MaxListedNames)
+            list += Acore::StringFormat(" and {} more", unknown.size() - MaxListedNames);
+
+        handler->SendSysMessage(Acore::StringFormat("|cffff0000[Guild Ban]|r Unknown characters: {}", list));
+    }
+
+    static bool HandleGbanListCommand(ChatHandler* handler, Optional<uint32> pageArg, Optional<std::string_view> sortArg)
     {
         Player* admin = handler->GetSession()->GetPlayer();
         if (!admin)
@@ -329,18 +854,76 @@ public:
             return false;
         }
 
-        auto bans = sGuildBanMgr->GetGuildBans(guild->GetId());
+        GuildBanSortOrder order = GUILD_BAN_SORT_DATE;
+        if (sortArg)
+        {
+            if (*sortArg == "type")
+                order = GUILD_BAN_SORT_TYPE;
+            else if (*sortArg == "expiry")
+                order = GUILD_BAN_SORT_EXPIRY;
+            else if (*sortArg != "date")
+            {
+                handler->SendErrorMessage("Unknown sort order, use date, type or expiry.");
+                return false;
+            }
+        }
 
-        if (bans.empty())
+        uint32 page = std::max<uint32>(pageArg.value_or(1), 1);
+
+        // Dates, officers and reasons may have to be read first in lazy mode, the reply can come later
+        sGuildBanMgr->LoadGuildDetails({ guild->GetId() }, [adminGuid = admin->GetGUID(), guildId = guild->GetId(), page, order]()
+        {
+            Player* admin = ObjectAccessor::FindConnectedPlayer(adminGuid);
+            Guild* guild = sGuildMgr->GetGuildById(guildId);
+            if (!admin || !guild)
+                return;
+
+            ChatHandler handler(admin->GetSession());
+            SendBanListPage(&handler, guild, page, order);
+        });
+
+        return true;
+    }
+
+    static void SendBanListPage(ChatHandler* handler, Guild* guild, uint32 page, GuildBanSortOrder order)
+    {
+        std::vector<GuildBanEntry> bans;
+        uint32 total = sGuildBanMgr->GetGuildBanPage(guild->GetId(), (page - 1) * ListPageSize, ListPageSize, order, bans);
+
+        if (!total)
         {
             handler->PSendSysMessage("|cff00ff00[Guild Ban]|r No bans for this guild.");
-            return true;
+            return;
+        }
+
+        uint32 pageCount = (total + ListPageSize - 1) / ListPageSize;
+        if (bans.empty())
+        {
+            handler->SendErrorMessage("Page %u does not exist, the ban list has %u pages.", page, pageCount);
+            return;
+        }
+
+        std::vector<std::string> lines;
+        lines.reserve(bans.size() + 1);
+        lines.push_back(Acore::StringFormat("|cff00ff00[Guild Ban]|r Ban list for <{}> - page {}/{} ({} bans):",
+                                            guild->GetName(), page, pageCount, total));
+
+        std::string subscriptions;
+        for (uint32 listId : sGuildBanMgr->GetSubscriptions(guild->GetId()))
+        {
+            if (GuildBanList const* list = sGuildBanMgr->GetSharedList(listId))
+            {
+                if (!subscriptions.empty())
+                    subscriptions += ", ";
+
+                subscriptions += list->name;
+            }
         }
 
-        handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Ban list for <%s>:", guild->GetName().c_str());
-        handler->PSendSysMessage("-------------------------------------------");
+        if (!subscriptions.empty())
+            lines.push_back(Acore::StringFormat("  Also enforced: shared ban lists {}", subscriptions));
 
-        for (auto const& ban : bans)
+        for (GuildBanEntry const& ban : bans)
         {
             std::string charName = "Unknown";
             if (CharacterCacheEntry const* entry = sCharacterCache->GetCharacterCacheByGuid(ObjectGuid::Create<HighGuid::Player>(ban.guid)))
@@ -348,17 +931,396 @@ public:
                 charName = entry->Name;
             }
 
-            std::string banTypeStr = ban.banType == GUILD_BAN_ACCOUNT ? "Account" : "Character";
             std::string expiryStr = ban.unbanDate == 0 ? "Permanent" : Acore::Time::TimeToTimestampStr(Seconds(ban.unbanDate));
 
-            handler->PSendSysMessage("  %s [%s] - Banned by: %s - Expires: %s",
-                                     charName.c_str(), banTypeStr.c_str(),
-                                     ban.bannedBy.c_str(), expiryStr.c_str());
-            handler->PSendSysMessage("    Reason: %s", ban.banReason.c_str());
+            lines.push_back(Acore::StringFormat("  {} [{}] - Banned by: {} - Expires: {} - Reason: {}",
+                                                charName, ban.banType == GUILD_BAN_ACCOUNT ? "Account" : "Character",
+                                                ban.bannedBy, expiryStr, ban.banReason));
+        }
+
+        SendPackedLines(handler, lines);
+    }
+
+    // One line of .gban history
+    static std::string FormatHistoryLine(uint32 date, uint32 guid, GuildBanHistoryAction action, GuildBanType banType,
+                                         std::string_view actor, std::string_view reason, uint32 unbanDate)
+    {
+        std::string charName = "Unknown";
+        if (CharacterCacheEntry const* entry = sCharacterCache->GetCharacterCacheByGuid(ObjectGuid::Create<HighGuid::Player>(guid)))
+            charName = entry->Name;
+
+        std::string dateStr = Acore::Time::TimeToTimestampStr(Seconds(date));
+        std::string_view type = banType == GUILD_BAN_ACCOUNT ? "Account" : "Character";
+
+        switch (action)
+        {
+            case GUILD_BAN_HISTORY_BAN:
+                return Acore::StringFormat("  {} - {} banned {} [{}] - Expires: {} - Reason: {}", dateStr, actor, charName, type,
+                                           unbanDate ? Acore::Time::TimeToTimestampStr(Seconds(unbanDate)) : "Permanent", reason);
+            case GUILD_BAN_HISTORY_UNBAN:
+                return Acore::StringFormat("  {} - {} lifted the ban of {} [{}]", dateStr, actor.empty() ? "Unknown" : actor, charName, type);
+            case GUILD_BAN_HISTORY_EXPIRE:
+                return Acore::StringFormat("  {} - Ban of {} [{}] expired", dateStr, charName, type);
+            default:
+                if (!guid)
+                    return Acore::StringFormat("  {} - All bans removed, the guild was disbanded", dateStr);
+
+                return Acore::StringFormat("  {} - Ban of {} [{}] removed, the character was deleted", dateStr, charName, type);
         }
+    }
+
+    // .gban history [player]: recent events come from memory, older ones from guild_bans_history
+    static bool HandleGbanHistoryCommand(ChatHandler* handler, Optional<PlayerIdentifier> target)
+    {
+        Player* admin = handler->GetSession()->GetPlayer();
+        if (!admin)
+            return false;
+
+        Guild* guild = admin->GetGuild();
+        if (!guild)
+        {
+            handler->SendErrorMessage("You are not in a guild.");
+            return false;
+        }
+
+        if (!CanBan(handler, guild, admin))
+            return false;
+
+        if (!sGuildBanMgr->IsHistoryEnabled())
+        {
+            handler->SendErrorMessage("Guild ban history is disabled.");
+            return false;
+        }
+
+        uint32 guildId = guild->GetId();
+        uint32 guid = target ? target->GetGUID().GetCounter() : 0;
+
+        std::vector<std::string> lines;
+        lines.push_back(Acore::StringFormat("|cff00ff00[Guild Ban]|r Ban history of <{}>{}{}:", guild->GetName(),
+                                            target ? " for " : "", target ? target->GetName() : ""));
+
+        // Events of the ring's oldest second may be partly evicted already, so the table is read
+        // from that second on and the ones still in the ring are dropped from the result
+        uint32 oldest = sGuildBanMgr->GetHistory().OldestDate();
+        std::vector<std::string> oldestLines;
+
+        sGuildBanMgr->GetHistory().ForEachNewest([&](GuildBanHistoryEvent const& event)
+        {
+            if (event.guildId == guildId && (!guid || event.guid == guid))
+            {
+                lines.push_back(FormatHistoryLine(event.date, event.guid, event.action, event.banType, event.actor, event.reason, event.unbanDate));
+                if (event.date == oldest)
+                    oldestLines.push_back(lines.back());
+            }
+
+            return lines.size() <= HistoryPageSize;
+        });
+
+        uint32 missing = HistoryPageSize + 1 - lines.size();
+        if (!missing)
+        {
+            SendPackedLines(handler, lines);
+            return true;
+        }
+
+        // The ring holds every event since its oldest one, older events are read from the table
+        uint32 until = oldest ? oldest : time(nullptr);
+
+        std::string guidFilter = guid ? Acore::StringFormat(" AND guid = {}", guid) : "";
+        WorldSession* session = handler->GetSession();
+
+        session->GetQueryProcessor().AddCallback(CharacterDatabase.AsyncQuery(
+            "SELECT eventDate, guid, action, banType, actor, reason, unbanDate FROM guild_bans_history "
+            "WHERE guildId = {}{} AND eventDate <= {} ORDER BY id DESC LIMIT {}", guildId, guidFilter, until, missing + oldestLines.size())
+            .WithCallback([session, oldest, lines = std::move(lines), oldestLines = std::move(oldestLines)](QueryResult result) mutable
+            {
+                if (result)
+                {
+                    do
+                    {
+                        Field* fields = result->Fetch();
+                        uint32 eventDate = fields[0].Get<uint32>();
+                        std::string line = FormatHistoryLine(eventDate, fields[1].Get<uint32>(),
+                                                             static_cast<GuildBanHistoryAction>(fields[2].Get<uint8>()),
+                                                             static_cast<GuildBanType>(fields[3].Get<uint8>()),
+                                                             fields[4].Get<std::string>(), fields[5].Get<std::string>(), fields[6].Get<uint32>());
+
+                        if (eventDate == oldest)
+                        {
+                            auto itr = std::find(oldestLines.begin(), oldestLines.end(), line);
+                            if (itr != oldestLines.end())
+                            {
+                                // Already listed from the ring
+                                oldestLines.erase(itr);
+                                continue;
+                            }
+                        }
+
+                        if (lines.size() <= HistoryPageSize)
+                            lines.push_back(std::move(line));
+                    } while (result->NextRow());
+                }
+
+                ChatHandler handler(session);
+                if (lines.size() == 1)
+                    lines.push_back("  No ban history.");
+
+                SendPackedLines(&handler, lines);
+            }));
+
+        return true;
+    }
+
+    // .gban lookup <player>: every guild the character or its account is banned from
+    static bool HandleGbanLookupCommand(ChatHandler* handler, PlayerIdentifier target)
+    {
+        ObjectGuid targetGuid = target.GetGUID();
+        std::string targetName = target.GetName();
+        uint32 accountId = sCharacterCache->GetCharacterAccountIdByGuid(targetGuid);
+
+        // The console has no session to answer later, it gets the details that are loaded
+        Player* admin = handler->GetSession() ? handler->GetSession()->GetPlayer() : nullptr;
+        if (!admin)
+        {
+            SendBanLookup(handler, targetGuid, targetName, accountId);
+            return true;
+        }
+
+        std::vector<uint32> guildIds;
+        for (GuildBanEntry const& ban : GetLookupBans(targetGuid.GetCounter(), accountId))
+            guildIds.push_back(ban.guildId);
+
+        sGuildBanMgr->LoadGuildDetails(guildIds, [adminGuid = admin->GetGUID(), targetGuid, targetName, accountId]()
+        {
+            if (Player* admin = ObjectAccessor::FindConnectedPlayer(adminGuid))
+            {
+                ChatHandler handler(admin->GetSession());
+                SendBanLookup(&handler, targetGuid, targetName, accountId);
+            }
+        });
 
         return true;
     }
+
+    static std::vector<GuildBanEntry> GetLookupBans(uint32 guid, uint32 accountId)
+    {
+        std::vector<GuildBanEntry> bans = sGuildBanMgr->GetCharacterBans(guid);
+
+        // Account bans placed on the player's other characters
+        for (GuildBanEntry const& ban : sGuildBanMgr->GetAccountBans(accountId))
+            if (ban.guid != guid && ban.banType == GUILD_BAN_ACCOUNT)
+                bans.push_back(ban);
+
+        return bans;
+    }
+
+    static void SendBanLookup(ChatHandler* handler, ObjectGuid targetGuid, std::string const& targetName, uint32 accountId)
+    {
+        uint32 guid = targetGuid.GetCounter();
+        std::vector<GuildBanEntry> bans = GetLookupBans(guid, accountId);
+
+        if (bans.empty())
+        {
+            handler->PSendSysMessage("|cff00ff00[Guild Ban]|r Player %s is not banned from any guild.", targetName.c_str());
+            return;
+        }
+
+        std::vector<std::string> lines;
+        lines.reserve(bans.size() + 1);
+        lines.push_back(Acore::StringFormat("|cff00ff00[Guild Ban]|r Guild bans of {} (account {}): {}",
+                                            targetName, accountId, bans.size()));
+
+        for (GuildBanEntry const& ban : bans)
+        {
+            std::string guildName;
+            if (IsGuildBanListGuildId(ban.guildId))
+            {
+                GuildBanList const* list = sGuildBanMgr->GetSharedList(ban.guildId & ~GuildBanListFlag);
+                guildName = Acore::StringFormat("list {}", list ? list->name : "?");
+            }
+            else if (Guild* guild = sGuildMgr->GetGuildById(ban.guildId))
+                guildName = guild->GetName();
+            else
+                guildName = Acore::StringFormat("#{}", ban.guildId);
+
+            std::string charName = targetName;
+            if (ban.guid != guid)
+            {
+                charName = "Unknown";
+                if (CharacterCacheEntry const* entry = sCharacterCache->GetCharacterCacheByGuid(ObjectGuid::Create<HighGuid::Player>(ban.guid)))
+                    charName = entry->Name;
+            }
+
+            std::string expiryStr = ban.unbanDate == 0 ? "Permanent" : Acore::Time::TimeToTimestampStr(Seconds(ban.unbanDate));
+
+            lines.push_back(Acore::StringFormat("  <{}> {} [{}] - Banned by: {} - Expires: {} - Reason: {}",
+                                                guildName, charName, ban.banType == GUILD_BAN_ACCOUNT ? "Account" : "Character",
+                                                ban.bannedBy, expiryStr, ban.banReason));
+        }
+
+        SendPackedLines(handler, lines);
+    }
+
+    static bool HandleGbanStatsCommand(ChatHandler* handler)
+    {
+        GuildBanStats const& stats = sGuildBanMgr->GetStats();
+        GuildBanMemoryStats memory = sGuildBanMgr->GetMemoryStats();
+        GuildBanIndex::FilterStats filter = sGuildBanMgr->GetFilterStats();
+
+        uint64 hits = stats.Get(GUILD_BAN_COUNTER_LOOKUP_HIT);
+        uint64 misses = stats.Get(GUILD_BAN_COUNTER_LOOKUP_MISS);
+
+        handler->SendSysMessage("|cff00ff00[Guild Ban]|r Statistics since startup:");
+        handler->SendSysMessage(Acore::StringFormat("  Lookups: {} ({} hits, {} misses), joins rejected: {}",
+                                                    hits + misses, hits, misses, stats.Get(GUILD_BAN_COUNTER_JOIN_REJECTED)));
+        handler->SendSysMessage(Acore::StringFormat("  Bans added: {}, removed: {}, rows written: {}, failed commits: {}",
+                                                    stats.Get(GUILD_BAN_COUNTER_BAN_ADDED), stats.Get(GUILD_BAN_COUNTER_BAN_REMOVED),
+                                                    stats.Get(GUILD_BAN_COUNTER_ROWS_WRITTEN), stats.Get(GUILD_BAN_COUNTER_WRITES_FAILED)));
+
+        static constexpr std::pair<GuildBanTimer, char const*> Timers[] =
+        {
+            { GUILD_BAN_TIMER_LOOKUP,     "Lookup (sampled)" },
+            { GUILD_BAN_TIMER_JOIN_CHECK, "Join check" },
+            { GUILD_BAN_TIMER_ADD_BAN,    "Add ban" },
+            { GUILD_BAN_TIMER_REMOVE_BAN, "Remove ban" },
+            { GUILD_BAN_TIMER_DB_WRITE,   "DB commit" },
+            { GUILD_BAN_TIMER_LOAD,       "Load" },
+        };
+
+        for (auto const& [timer, name] : Timers)
+        {
+            GuildBanHistogram::Summary summary = stats.Summarize(timer);
+            handler->SendSysMessage(Acore::StringFormat("  {}: {} samples, mean {}, p50 {}, p99 {}, max {}",
+                                                        name, summary.count, FormatGuildBanLatency(summary.mean),
+                                                        FormatGuildBanLatency(summary.p50), FormatGuildBanLatency(summary.p99),
+                                                        FormatGuildBanLatency(summary.max)));
+        }
+
+        handler->SendSysMessage(Acore::StringFormat("  Memory: index {} KB, records {} KB ({} bans), account cache {} KB ({} accounts), history {} KB, {} queued writes",
+                                                    memory.index / 1024, memory.store / 1024, memory.bans,
+                                                    memory.accountCache / 1024, memory.cachedAccounts, memory.history / 1024,
+                                                    memory.pendingWrites));
+
+        if (sGuildBanMgr->IsLazyLoaded())
+            handler->SendSysMessage(Acore::StringFormat("  Lazy details: {} guilds loaded, {} of {} KB",
+                                                        memory.detailGuilds, memory.guildDetails / 1024, sGuildBanMgr->GetLazyMemoryCap()));
+
+        handler->SendSysMessage(Acore::StringFormat("  Filter: {} ids, {} passes, {} false positives",
+                                                    filter.keys, filter.passes, filter.falsePositives));
+        return true;
+    }
+
+    static bool HandleGbanReloadCommand(ChatHandler* handler, Optional<std::string_view> mode)
+    {
+        if (mode && *mode == "full")
+        {
+            sGuildBanMgr->LoadFromDB();
+            handler->SendSysMessage("|cff00ff00[Guild Ban]|r Reloaded all guild bans from the database.");
+            return true;
+        }
+
+        if (mode)
+        {
+            handler->SendErrorMessage("Usage: .gban reload [full]");
+            return false;
+        }
+
+        sGuildBanMgr->SyncFromDB();
+        handler->SendSysMessage("|cff00ff00[Guild Ban]|r Applying guild ban changes from the database, see the server log for the result.");
+        return true;
+    }
+
+    // .gban verify [start]: report of the last consistency check, or start a new one
+    static bool HandleGbanVerifyCommand(ChatHandler* handler, Optional<std::string_view> mode)
+    {
+        if (mode && *mode != "start")
+        {
+            handler->SendErrorMessage("Usage: .gban verify [start]");
+            return false;
+        }
+
+        if (mode)
+        {
+            if (!sGuildBanMgr->StartVerify())
+            {
+                handler->SendErrorMessage("A consistency check is already running.");
+                return false;
+            }
+
+            handler->SendSysMessage("|cff00ff00[Guild Ban]|r Consistency check started, see .gban verify for its progress.");
+            return true;
+        }
+
+        GuildBanVerifyReport const& report = sGuildBanMgr->GetVerifyReport();
+
+        if (!report.startedAt)
+        {
+            handler->SendSysMessage("|cff00ff00[Guild Ban]|r No consistency check has run yet.");
+            return true;
+        }
+
+        if (sGuildBanMgr->IsVerifyRunning())
+            handler->SendSysMessage(Acore::StringFormat("|cff00ff00[Guild Ban]|r Consistency check running since {}:",
+                                                        Acore::Time::TimeToTimestampStr(Seconds(report.startedAt))));
+        else if (report.finishedAt)
+            handler->SendSysMessage(Acore::StringFormat("|cff00ff00[Guild Ban]|r Last consistency check finished {} ({} s):",
+                                                        Acore::Time::TimeToTimestampStr(Seconds(report.finishedAt)),
+                                                        report.finishedAt - report.startedAt));
+        else
+            handler->SendSysMessage(Acore::StringFormat("|cff00ff00[Guild Ban]|r Last consistency check, started {}, was aborted by a reload:",
+                                                        Acore::Time::TimeToTimestampStr(Seconds(report.startedAt))));
+
+        handler->SendSysMessage(Acore::StringFormat("  Rows checked: {}, not loaded: {}, loaded without a row: {}, differing: {}",
+                                                    report.rowsChecked, report.missingInMemory, report.missingInDatabase, report.differing));
+        handler->SendSysMessage(Acore::StringFormat("  Missing from the lookup index: {}, repaired: {}", report.indexDrift, report.repaired));
+        return true;
+    }
+
+    // Sends several lines per system message packet instead of one packet per line
+    static void SendPackedLines(ChatHandler* handler, std::vector<std::string> const& lines)
+    {
+        // Console and SOAP have no session to send packets to
+        if (!handler->GetSession())
+        {
+            for (std::string const& line : lines)
+                handler->SendSysMessage(line);
+
+            return;
+        }
+
+        std::string message;
+        uint32 packed = 0;
+
+        for (std::string const& line : lines)
+        {
+            if (packed)
+                message += '\n';
+
+            message += line;
+
+            if (++packed == LinesPerPacket)
+            {
+                SendSystemPacket(handler, message);
+                message.clear();
+                packed = 0;
+            }
+        }
+
+        if (packed)
+            SendSystemPacket(handler, message);
+    }
+
+    static void SendSystemPacket(ChatHandler* handler, std::string_view message)
+    {
+        WorldPacket data;
+        ChatHandler::BuildChatPacket(data, CHAT_MSG_SYSTEM, LANG_UNIVERSAL, nullptr, nullptr, message);
+        handler->GetSession()->SendPacket(&data);
+    }
+
+    static constexpr uint32 ListPageSize = 15;
+    static constexpr uint32 HistoryPageSize = 15;
+    static constexpr uint32 MaxSharedListNameLength = 32;
+    static constexpr uint32 LinesPerPacket = 4;
 };
 
 void AddGuildBanCommands()
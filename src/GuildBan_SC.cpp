@@ -16,6 +16,7 @@
  */
 
 #include "GuildBan.h"
+#include "CharacterCache.h"
 #include "Chat.h"
 #include "Config.h"
 #include "DatabaseEnv.h"
@@ -25,8 +26,15 @@
 #include "Log.h"
 #include "ObjectMgr.h"
 #include "Player.h"
+#include "PlayerScript.h"
 #include "ScriptMgr.h"
+#include "ServerScript.h"
+#include "WorldPacket.h"
 #include "WorldSession.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 // Singleton implementation
 GuildBanMgr* GuildBanMgr::instance()
@@ -40,80 +48,1495 @@ void GuildBanMgr::LoadConfig()
     _enabled = sConfigMgr->GetOption<bool>("GuildBan.Enable", true);
     _allowOfficerBan = sConfigMgr->GetOption<bool>("GuildBan.AllowOfficerBan", false);
     _notifyOnBannedJoinAttempt = sConfigMgr->GetOption<bool>("GuildBan.NotifyOnBannedJoinAttempt", true);
+    _loadThreads = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("GuildBan.Load.Threads", 2));
+    _loadPageSize = std::max<uint32>(100, sConfigMgr->GetOption<uint32>("GuildBan.Load.PageSize", 5000));
+    _writeFlushInterval = sConfigMgr->GetOption<uint32>("GuildBan.Write.FlushInterval", 1000);
+    _writeBatchSize = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("GuildBan.Write.BatchSize", 500));
+    _statsLogInterval = sConfigMgr->GetOption<uint32>("GuildBan.Stats.LogInterval", 0) * IN_MILLISECONDS;
+    _snapshotFile = sConfigMgr->GetOption<std::string>("GuildBan.Snapshot.File", "");
+    _snapshotInterval = sConfigMgr->GetOption<uint32>("GuildBan.Snapshot.Interval", 300) * IN_MILLISECONDS;
+    _syncInterval = sConfigMgr->GetOption<uint32>("GuildBan.Sync.Interval", 0) * IN_MILLISECONDS;
+    _importDirectory = sConfigMgr->GetOption<std::string>("GuildBan.Import.Directory", "");
+    _changeLogEnabled = sConfigMgr->GetOption<bool>("GuildBan.ChangeLog.Enable", false);
+    _changeLogPollInterval = sConfigMgr->GetOption<uint32>("GuildBan.ChangeLog.PollInterval", 1000);
+    _purgeInterval = sConfigMgr->GetOption<uint32>("GuildBan.Purge.Interval", 1000);
+    _purgeChunkSize = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("GuildBan.Purge.ChunkSize", 1000));
+    _purgeOrphansOnStartup = sConfigMgr->GetOption<bool>("GuildBan.Purge.OrphansOnStartup", true);
+    _joinThrottleBurst = std::max<uint32>(1, sConfigMgr->GetOption<uint32>("GuildBan.JoinThrottle.Burst", 3));
+    _joinThrottleRefill = sConfigMgr->GetOption<uint32>("GuildBan.JoinThrottle.RefillInterval", 10) * IN_MILLISECONDS;
+    _joinDigestInterval = sConfigMgr->GetOption<uint32>("GuildBan.NotifyDigestInterval", 60) * IN_MILLISECONDS;
+    _maxSubscriptions = sConfigMgr->GetOption<uint32>("GuildBan.SharedLists.MaxSubscriptions", 5);
+    _verifyInterval = sConfigMgr->GetOption<uint32>("GuildBan.Verify.Interval", 0) * IN_MILLISECONDS;
+    _verifyChunkSize = std::max<uint32>(10, sConfigMgr->GetOption<uint32>("GuildBan.Verify.ChunkSize", 500));
+    _verifyBudget = std::max<uint32>(10, sConfigMgr->GetOption<uint32>("GuildBan.Verify.TickBudget", 200));
+    _verifyRepair = sConfigMgr->GetOption<bool>("GuildBan.Verify.Repair", false);
+    _historyEnabled = sConfigMgr->GetOption<bool>("GuildBan.History.Enable", true);
+    _historyMemorySize = sConfigMgr->GetOption<uint32>("GuildBan.History.MemorySize", 1000);
+    _historyRetentionDays = sConfigMgr->GetOption<uint32>("GuildBan.History.RetentionDays", 0);
+    // Only read by the next full load, a running server keeps the mode its bans were loaded in
+    _lazyLoading = sConfigMgr->GetOption<bool>("GuildBan.Lazy.Enable", false);
+    _lazyMemoryCap = sConfigMgr->GetOption<uint32>("GuildBan.Lazy.MemoryCap", 4096);
+
+    uint32 historyCapacity = _historyEnabled ? _historyMemorySize : 0;
+    if (_history.Capacity() != historyCapacity)
+        _history.Resize(historyCapacity);
+}
+
+namespace
+{
+    // Columns of GuildBanInfo, the details last so lazy loads can leave them out
+    constexpr char const* GuildBanColumns = "guildId, guid, accountId, unbanDate, banType";
+    constexpr char const* GuildBanDetailColumns = ", banDate, bannedBy, banReason";
+
+    GuildBanInfo ReadGuildBanRow(Field* fields, bool withDetails)
+    {
+        GuildBanInfo info;
+        info.guildId    = fields[0].Get<uint32>();
+        info.guid       = fields[1].Get<uint32>();
+        info.accountId  = fields[2].Get<uint32>();
+        info.unbanDate  = fields[3].Get<uint32>();
+        info.banType    = static_cast<GuildBanType>(fields[4].Get<uint8>());
+        info.banDate    = 0;
+
+        if (withDetails)
+        {
+            info.banDate    = fields[5].Get<uint32>();
+            info.bannedBy   = fields[6].Get<std::string>();
+            info.banReason  = fields[7].Get<std::string>();
+        }
+
+        return info;
+    }
+
+    // Pages through guild ids [minGuildId, maxGuildId] in primary key order, pageSize rows at a time.
+    // Runs on a loader thread, the rows of all partitions are merged afterwards.
+    void LoadGuildBanPartition(uint32 minGuildId, uint32 maxGuildId, uint32 now, uint32 pageSize, bool withDetails,
+                               std::vector<GuildBanInfo>& bans)
+    {
+        uint32 lastGuildId = minGuildId;
+        uint32 lastGuid = 0;
+
+        while (true)
+        {
+            QueryResult result = CharacterDatabase.Query(
+                "SELECT {}{} FROM guild_bans "
+                "WHERE guildId BETWEEN {} AND {} AND (guildId, guid) > ({}, {}) AND (unbanDate = 0 OR unbanDate > {}) "
+                "ORDER BY guildId, guid LIMIT {}",
+                GuildBanColumns, withDetails ? GuildBanDetailColumns : "",
+                minGuildId, maxGuildId, lastGuildId, lastGuid, now, pageSize);
+
+            if (!result)
+                return;
+
+            uint64 rows = result->GetRowCount();
+
+            do
+            {
+                GuildBanInfo info = ReadGuildBanRow(result->Fetch(), withDetails);
+
+                lastGuildId = info.guildId;
+                lastGuid = info.guid;
+
+                bans.push_back(std::move(info));
+
+            } while (result->NextRow());
+
+            if (rows < pageSize)
+                return;
+        }
+    }
+}
+
+void GuildBanMgr::LoadFromDB()
+{
+    GuildBanScopedTimer timer(_stats, GUILD_BAN_TIMER_LOAD);
+    uint32 oldMSTime = getMSTime();
+    uint32 now = time(nullptr);
+
+    // Queued writes must reach the table before it is read back
+    FlushPendingWrites(true);
+
+    // Changes logged while the table is read are applied again afterwards, which is harmless
+    InitChangeLog();
+
+    // Expired temporary bans are dropped with one set-based statement and skipped by the loader
+    CharacterDatabase.Execute("DELETE FROM guild_bans WHERE unbanDate BETWEEN 1 AND {}", now);
+    // Deletions older than this have been seen by every sync
+    CharacterDatabase.Execute("DELETE FROM guild_bans_deleted WHERE deletedAt < NOW() - INTERVAL {} SECOND", DeletedRetention);
+
+    LoadSharedLists();
+
+    // Shared list ids are far above any guild id, their bans get a partition of their own
+    QueryResult bounds = CharacterDatabase.Query(
+        "SELECT MIN(IF(guildId < {0}, guildId, NULL)), MAX(IF(guildId < {0}, guildId, NULL)), COUNT(*), "
+        "CAST(UNIX_TIMESTAMP(NOW(3)) * 1000 AS UNSIGNED) FROM guild_bans WHERE unbanDate = 0 OR unbanDate > {1}",
+        GuildBanListFlag, now);
+
+    // Later incremental syncs pick up rows changed after this point, measured on the database clock
+    if (bounds)
+        _syncWatermark = bounds->Fetch()[3].Get<uint64>();
+
+    if (!bounds || !bounds->Fetch()[2].Get<uint64>())
+    {
+        GuildBanIndex::Writer(_index, true).Commit();
+        _bans = GuildBanStore();
+        _expiryQueue = {};
+        ResetGuildDetails(false);
+
+        LOG_INFO("module", ">> Loaded 0 guild bans. Table `guild_bans` is empty.");
+        return;
+    }
+
+    uint32 minGuildId = bounds->Fetch()[0].Get<uint32>();
+    uint32 maxGuildId = bounds->Fetch()[1].Get<uint32>();
+    uint64 guildSpan = uint64(maxGuildId) - minGuildId + 1;
+
+    // Split the guild id range into more partitions than threads so a few huge guilds do not serialize the load
+    uint32 threads = std::max<uint32>(1, std::min<uint64>(_loadThreads, guildSpan));
+    uint32 guildPartitions = std::min<uint64>(threads > 1 ? threads * 4 : 1, guildSpan);
+    uint32 partitions = guildPartitions + 1;
+
+    std::vector<std::vector<GuildBanInfo>> partials(partitions);
+    std::atomic<uint32> nextPartition = 0;
+
+    auto worker = [&]()
+    {
+        for (uint32 p; (p = nextPartition.fetch_add(1)) < partitions;)
+        {
+            if (p == guildPartitions)
+            {
+                LoadGuildBanPartition(GuildBanListFlag, UINT32_MAX, now, _loadPageSize, !_lazyLoading, partials[p]);
+                continue;
+            }
+
+            uint32 first = minGuildId + guildSpan * p / guildPartitions;
+            uint32 last = minGuildId + guildSpan * (p + 1) / guildPartitions - 1;
+            LoadGuildBanPartition(first, last, now, _loadPageSize, !_lazyLoading, partials[p]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (uint32 i = 1; i < threads; ++i)
+        pool.emplace_back(worker);
+
+    worker();
+
+    for (std::thread& thread : pool)
+        thread.join();
+
+    uint32 count = ReplaceBans(partials);
+    ResetGuildDetails(_lazyLoading);
+
+    uint32 elapsed = GetMSTimeDiffToNow(oldMSTime);
+    LOG_INFO("module", ">> Loaded {} guild bans{} in {} ms ({} rows/s, {} threads)",
+        count, _lazyLoading ? " without details" : "", elapsed, uint64(count) * 1000 / std::max<uint32>(elapsed, 1), threads);
+
+    GuildBanIndex::FilterStats filter = _index.GetFilterStats();
+    LOG_INFO("module", ">> Guild ban filter: {} ids in {} KB, estimated false-positive rate {:.4f}%",
+        filter.keys, filter.bytes / 1024, filter.estimatedFalsePositiveRate * 100.0);
+}
+
+void GuildBanMgr::InitChangeLog()
+{
+    if (!_changeLogEnabled)
+        return;
+
+    // Entries older than this have been read by every running worldserver
+    CharacterDatabase.Execute("DELETE FROM guild_bans_log WHERE createdAt < NOW() - INTERVAL 1 DAY");
+
+    QueryResult result = CharacterDatabase.Query("SELECT CAST(COALESCE(MAX(seq), 0) AS UNSIGNED) FROM guild_bans_log");
+    _changeLog.Reset(result ? result->Fetch()[0].Get<uint64>() : 0);
+}
+
+void GuildBanMgr::PollChangeLog()
+{
+    if (_changeLogPollInProgress)
+        return;
+
+    _changeLogPollInProgress = true;
+
+    // The LEFT JOIN returns each logged key's current row, or NULLs once it was deleted
+    _queryProcessor.AddCallback(CharacterDatabase.AsyncQuery(
+        "SELECT l.seq, l.type, l.guildId, l.guid, b.guid, b.accountId, b.banDate, b.unbanDate, b.bannedBy, b.banReason, b.banType "
+        "FROM guild_bans_log l LEFT JOIN guild_bans b ON b.guildId = l.guildId AND b.guid = l.guid "
+        "WHERE l.seq > {} ORDER BY l.seq LIMIT {}", _changeLog.GetSeq(), ChangeLogBatchSize)
+        .WithCallback([this](QueryResult result)
+        {
+            _changeLogPollInProgress = false;
+
+            if (!result)
+                return;
+
+            std::vector<GuildBanLogEntry> entries;
+            entries.reserve(result->GetRowCount());
+
+            do
+            {
+                Field* fields = result->Fetch();
+
+                GuildBanLogEntry& entry = entries.emplace_back();
+                entry.seq     = fields[0].Get<uint64>();
+                entry.type    = static_cast<GuildBanLogType>(fields[1].Get<uint8>());
+                entry.guildId = fields[2].Get<uint32>();
+                entry.guid    = fields[3].Get<uint32>();
+
+                if (entry.type != GUILD_BAN_LOG_BAN || !entry.guid || fields[4].IsNull())
+                    continue;
+
+                GuildBanInfo& info = entry.row.emplace();
+                info.guildId    = entry.guildId;
+                info.guid       = entry.guid;
+                info.accountId  = fields[5].Get<uint32>();
+                info.banDate    = fields[6].Get<uint32>();
+                info.unbanDate  = fields[7].Get<uint32>();
+                info.bannedBy   = fields[8].Get<std::string>();
+                info.banReason  = fields[9].Get<std::string>();
+                info.banType    = static_cast<GuildBanType>(fields[10].Get<uint8>());
+            } while (result->NextRow());
+
+            // What ApplyGuildBanLog does to this worldserver's bans
+            struct Target
+            {
+                GuildBanMgr& mgr;
+
+                bool IsLocallyModified(uint64 key) const { return mgr.IsLocallyModified(key); }
+                bool ApplyBan(GuildBanInfo const& info, GuildBanIndex::Writer& writer) { return mgr.ApplyBan(info, writer); }
+                bool EraseBan(uint32 guildId, uint32 guid, GuildBanIndex::Writer& writer) { return mgr._bans.Erase(guildId, guid, writer); }
+                uint32 DropGuild(uint32 guildId, GuildBanIndex::Writer& writer) { return mgr.DropGuild(guildId, writer); }
+            } target{ *this };
+
+            GuildBanIndex::Writer writer(_index);
+            GuildBanLogResult applied = ApplyGuildBanLog(std::span<GuildBanLogEntry const>(entries), target, writer);
+            writer.Commit();
+
+            _changeLog.Advance(entries, getMSTime());
+
+            if (applied.changed)
+                LOG_DEBUG("module", "Guild ban change log: applied {} changes up to seq {}", applied.changed, _changeLog.GetSeq());
+
+            if (applied.sharedListsChanged)
+                ReloadSharedLists();
+        }));
+}
+
+bool GuildBanMgr::IsLocallyModified(uint64 key) const
+{
+    // Local changes that have not reached the table yet win over what is read back from it
+    if (_pendingWrites.count(key) || _inFlightWrites.Find(key))
+        return true;
+
+    // Rows of a purged guild stay in the table until its chunked delete reaches them
+    uint32 guildId = GuildBanKeyGuildId(key);
+    return std::any_of(_guildPurges.begin(), _guildPurges.end(), [guildId](auto const& purge) { return purge.first == guildId; });
+}
+
+bool GuildBanMgr::ApplyBan(GuildBanInfo const& info, GuildBanIndex::Writer& writer)
+{
+    Optional<GuildBanEntry> current = _bans.Find(info.guildId, info.guid);
+    if (current && IsSameLoadedBan(*current, info))
+        return false;
+
+    _bans.Set(info, writer);
+
+    if (info.unbanDate)
+        _expiryQueue.push({ info.unbanDate, info.guildId, info.guid });
+
+    return true;
+}
+
+bool GuildBanMgr::HasGuildDetails(uint32 guildId) const
+{
+    return !_detailsPartial || _detailGuilds.count(guildId);
+}
+
+bool GuildBanMgr::IsSameLoadedBan(GuildBanEntry const& ban, GuildBanInfo const& info) const
+{
+    if (HasGuildDetails(ban.guildId))
+        return IsSameGuildBan(ban, info);
+
+    return ban.accountId == info.accountId && ban.unbanDate == info.unbanDate && ban.banType == info.banType;
+}
+
+void GuildBanMgr::LoadGuildDetails(std::vector<uint32> const& guildIds, std::function<void()> callback)
+{
+    // One count per guild plus one released below, so a callback run right away cannot finish early
+    auto remaining = std::make_shared<uint32>(guildIds.size() + 1);
+    auto done = [remaining, callback = std::move(callback)]()
+    {
+        if (!--*remaining)
+            callback();
+    };
+
+    for (uint32 guildId : guildIds)
+        QueryGuildDetails(guildId, done);
+
+    done();
+}
+
+void GuildBanMgr::QueryGuildDetails(uint32 guildId, std::function<void()> callback)
+{
+    if (!_detailsPartial)
+    {
+        callback();
+        return;
+    }
+
+    auto loaded = _detailGuilds.find(guildId);
+    if (loaded != _detailGuilds.end())
+    {
+        _detailGuildLru.splice(_detailGuildLru.begin(), _detailGuildLru, loaded->second.lru);
+        callback();
+        return;
+    }
+
+    // The first request starts the query, later ones only queue their callback
+    std::vector<std::function<void()>>& waiters = _detailWaiters[guildId];
+    waiters.push_back(std::move(callback));
+    if (waiters.size() > 1)
+        return;
+
+    _queryProcessor.AddCallback(CharacterDatabase.AsyncQuery(
+        "SELECT {}{} FROM guild_bans WHERE guildId = {} AND (unbanDate = 0 OR unbanDate > {})",
+        GuildBanColumns, GuildBanDetailColumns, guildId, uint32(time(nullptr)))
+        .WithCallback([this, guildId](QueryResult result)
+        {
+            std::size_t bytes = 0;
+            GuildBanIndex::Writer writer(_index);
+
+            if (result)
+            {
+                do
+                {
+                    GuildBanInfo info = ReadGuildBanRow(result->Fetch(), true);
+                    bytes += sizeof(GuildBanRecordDetails) + info.bannedBy.size() + info.banReason.size();
+
+                    if (IsLocallyModified(MakeGuildBanKey(info.guildId, info.guid)))
+                        continue;
+
+                    // A row that differs in more than its details changed since the load
+                    if (!_bans.SetDetails(info))
+                        ApplyBan(info, writer);
+                } while (result->NextRow());
+            }
+
+            writer.Commit();
+
+            // A full load in between replaced the bans the query was started for
+            if (_detailsPartial && !_detailGuilds.count(guildId))
+            {
+                _detailGuildLru.push_front(guildId);
+                _detailGuilds[guildId] = { _detailGuildLru.begin(), bytes };
+                _detailBytes += bytes;
+                EvictGuildDetails();
+            }
+
+            auto waiters = _detailWaiters.extract(guildId);
+            for (auto const& callback : waiters.mapped())
+                callback();
+        }));
+}
+
+void GuildBanMgr::ResetGuildDetails(bool partial)
+{
+    _detailsPartial = partial;
+    _detailGuilds.clear();
+    _detailGuildLru.clear();
+    _detailBytes = 0;
+}
+
+void GuildBanMgr::ForgetGuildDetails(uint32 guildId)
+{
+    auto it = _detailGuilds.find(guildId);
+    if (it == _detailGuilds.end())
+        return;
+
+    _detailBytes -= it->second.bytes;
+    _detailGuildLru.erase(it->second.lru);
+    _detailGuilds.erase(it);
+}
+
+void GuildBanMgr::EvictGuildDetails()
+{
+    // The most recently used guild stays even when it alone exceeds the cap
+    while (_detailBytes > std::size_t(_lazyMemoryCap) * 1024 && _detailGuildLru.size() > 1)
+    {
+        uint32 guildId = _detailGuildLru.back();
+
+        // Bans with writes still queued keep their details, loading them again would skip those
+        if (std::vector<uint32> const* slots = _bans.GetGuildSlots(guildId))
+            for (uint32 slot : *slots)
+                if (!IsLocallyModified(MakeGuildBanKey(guildId, _bans.GetRecord(slot).guid)))
+                    _bans.ClearDetails(slot);
+
+        ForgetGuildDetails(guildId);
+    }
+}
+
+void GuildBanMgr::SyncFromDB()
+{
+    if (_syncInProgress)
+        return;
+
+    _syncInProgress = true;
+
+    struct SyncState
+    {
+        uint64 watermark = 0;
+        QueryResult deleted;
+    };
+
+    auto state = std::make_shared<SyncState>();
+    uint64 since = _syncWatermark > SyncLookback ? _syncWatermark - SyncLookback : 0;
+
+    // Read the database clock first so nothing committed while the queries run is skipped next time
+    _queryProcessor.AddCallback(CharacterDatabase.AsyncQuery("SELECT CAST(UNIX_TIMESTAMP(NOW(3)) * 1000 AS UNSIGNED)")
+        .WithChainingCallback([state, since](QueryCallback& callback, QueryResult result)
+        {
+            if (result)
+                state->watermark = result->Fetch()[0].Get<uint64>();
+
+            callback.SetNextQuery(CharacterDatabase.AsyncQuery(
+                "SELECT guildId, guid FROM guild_bans_deleted WHERE deletedAt >= FROM_UNIXTIME({} / 1000)", since));
+        })
+        .WithChainingCallback([state, since](QueryCallback& callback, QueryResult result)
+        {
+            state->deleted = std::move(result);
+
+            callback.SetNextQuery(CharacterDatabase.AsyncQuery(
+                "SELECT guildId, guid, accountId, banDate, unbanDate, bannedBy, banReason, banType FROM guild_bans "
+                "WHERE updatedAt >= FROM_UNIXTIME({} / 1000)", since));
+        })
+        .WithCallback([this, state](QueryResult result)
+        {
+            _syncInProgress = false;
+
+            if (!state->watermark)
+            {
+                LOG_ERROR("module", "Guild ban sync failed, is `guild_bans` missing the `updatedAt` column?");
+                return;
+            }
+
+            uint32 changed = 0;
+            uint32 removed = 0;
+            uint32 skipped = 0;
+
+            GuildBanIndex::Writer writer(_index);
+            GuildBanKeySet present;
+            uint32 now = time(nullptr);
+
+            if (result)
+            {
+                do
+                {
+                    Field* fields = result->Fetch();
+
+                    GuildBanInfo info;
+                    info.guildId    = fields[0].Get<uint32>();
+                    info.guid       = fields[1].Get<uint32>();
+                    info.accountId  = fields[2].Get<uint32>();
+                    info.banDate    = fields[3].Get<uint32>();
+                    info.unbanDate  = fields[4].Get<uint32>();
+                    info.bannedBy   = fields[5].Get<std::string>();
+                    info.banReason  = fields[6].Get<std::string>();
+                    info.banType    = static_cast<GuildBanType>(fields[7].Get<uint8>());
+
+                    uint64 key = MakeGuildBanKey(info.guildId, info.guid);
+                    present.Insert(key);
+
+                    if (IsLocallyModified(key))
+                    {
+                        ++skipped;
+                        continue;
+                    }
+
+                    // Lifted elsewhere by moving unbanDate into the past
+                    if (info.unbanDate && info.unbanDate <= now)
+                    {
+                        if (_bans.Erase(info.guildId, info.guid, writer))
+                            ++removed;
+
+                        continue;
+                    }
+
+                    // Rows inside the lookback window are usually unchanged
+                    if (ApplyBan(info, writer))
+                        ++changed;
+                } while (result->NextRow());
+            }
+
+            if (state->deleted)
+            {
+                do
+                {
+                    Field* fields = state->deleted->Fetch();
+                    uint32 guildId = fields[0].Get<uint32>();
+                    uint32 guid = fields[1].Get<uint32>();
+                    uint64 key = MakeGuildBanKey(guildId, guid);
+
+                    // Deleted and inserted again since the last sync
+                    if (present.Contains(key))
+                        continue;
+
+                    if (IsLocallyModified(key))
+                    {
+                        ++skipped;
+                        continue;
+                    }
+
+                    if (_bans.Erase(guildId, guid, writer))
+                        ++removed;
+                } while (state->deleted->NextRow());
+            }
+
+            writer.Commit();
+            _syncWatermark = state->watermark;
+
+            if (changed || removed)
+                LOG_INFO("module", "Guild ban sync: {} bans added or changed, {} removed, {} skipped with local changes pending",
+                    changed, removed, skipped);
+        }));
+}
+
+uint32 GuildBanMgr::ReplaceBans(std::vector<std::vector<GuildBanInfo>> const& parts)
+{
+    // The new state is built aside and published at once, bans stay enforced
+    // from the old index during a reload.
+
+    // Slots and guilds a running consistency pass refers to are about to go away
+    CancelVerify();
+
+    GuildBanIndex::Writer writer(_index, true);
+    GuildBanStore bans;
+    std::vector<GuildBanExpiry> expiries;
+    uint32 count = bans.Load(parts, writer, expiries);
+    writer.Commit();
+    _bans = std::move(bans);
+    ResetGuildDetails(false);
+
+    // Heapify once instead of pushing every temporary ban
+    _expiryQueue = decltype(_expiryQueue)(std::greater<>(), std::move(expiries));
+
+    return count;
+}
+
+void GuildBanMgr::QueueWrite(GuildBanWriteOp op, uint32 guildId, uint32 guid, GuildBanInfo const& banInfo)
+{
+    GuildBanPendingWrite& write = _pendingWrites[MakeGuildBanKey(guildId, guid)];
+    write.op = op;
+    write.info = banInfo;
+}
+
+void GuildBanMgr::SaveBanToDB(GuildBanInfo const& banInfo)
+{
+    QueueWrite(GUILD_BAN_WRITE_SAVE, banInfo.guildId, banInfo.guid, banInfo);
+
+    if (_pendingWrites.size() >= _writeBatchSize)
+        FlushPendingWrites();
+}
+
+void GuildBanMgr::RemoveBanFromDB(uint32 guildId, uint32 guid)
+{
+    QueueWrite(GUILD_BAN_WRITE_DELETE, guildId, guid, GuildBanInfo());
+
+    if (_pendingWrites.size() >= _writeBatchSize)
+        FlushPendingWrites();
+}
+
+void GuildBanMgr::FlushPendingWrites(bool synchronous /*= false*/)
+{
+    _flushTimer = 0;
+
+    if (_pendingWrites.empty() && _pendingHistory.empty())
+        return;
+
+    // Rows per multi-row statement, keeps each statement well below max_allowed_packet
+    static constexpr uint32 MaxRowsPerStatement = 500;
+
+    CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+
+    std::string saveSql;
+    std::string deleteSql;
+    uint32 saveRows = 0;
+    uint32 deleteRows = 0;
+
+    auto flushSaves = [&]()
+    {
+        saveSql += " ON DUPLICATE KEY UPDATE accountId = VALUES(accountId), banDate = VALUES(banDate), "
+            "unbanDate = VALUES(unbanDate), bannedBy = VALUES(bannedBy), banReason = VALUES(banReason), banType = VALUES(banType)";
+        trans->Append(saveSql);
+        saveSql.clear();
+        saveRows = 0;
+    };
+
+    auto flushDeletes = [&]()
+    {
+        deleteSql += ')';
+        trans->Append(deleteSql);
+        deleteSql.clear();
+        deleteRows = 0;
+    };
+
+    for (auto& [key, write] : _pendingWrites)
+    {
+        if (write.op == GUILD_BAN_WRITE_DELETE)
+        {
+            deleteSql += deleteRows ? ", " : "DELETE FROM guild_bans WHERE (guildId, guid) IN (";
+            deleteSql += Acore::StringFormat("({}, {})", GuildBanKeyGuildId(key), GuildBanKeyId(key));
+
+            if (++deleteRows == MaxRowsPerStatement)
+                flushDeletes();
+
+            continue;
+        }
+
+        GuildBanInfo& info = write.info;
+        CharacterDatabase.EscapeString(info.bannedBy);
+        CharacterDatabase.EscapeString(info.banReason);
+
+        saveSql += saveRows ? ", " : "INSERT INTO guild_bans (guildId, guid, accountId, banDate, unbanDate, bannedBy, banReason, banType) VALUES ";
+        saveSql += Acore::StringFormat("({}, {}, {}, {}, {}, '{}', '{}', {})",
+            info.guildId, info.guid, info.accountId, info.banDate, info.unbanDate,
+            info.bannedBy, info.banReason, static_cast<uint8>(info.banType));
+
+        if (++saveRows == MaxRowsPerStatement)
+            flushSaves();
+    }
+
+    if (saveRows)
+        flushSaves();
+
+    if (deleteRows)
+        flushDeletes();
+
+    // Other worldservers tail guild_bans_log and re-read the rows it names
+    if (_changeLogEnabled)
+    {
+        std::string logSql;
+        uint32 logRows = 0;
+
+        for (auto const& [key, write] : _pendingWrites)
+        {
+            logSql += logRows ? ", " : "INSERT INTO guild_bans_log (guildId, guid) VALUES ";
+            logSql += Acore::StringFormat("({}, {})", GuildBanKeyGuildId(key), GuildBanKeyId(key));
+
+            if (++logRows == MaxRowsPerStatement)
+            {
+                trans->Append(logSql);
+                logSql.clear();
+                logRows = 0;
+            }
+        }
+
+        if (logRows)
+            trans->Append(logSql);
+    }
+
+    std::string historySql;
+    uint32 historyRows = 0;
+
+    for (GuildBanHistoryEvent& event : _pendingHistory)
+    {
+        CharacterDatabase.EscapeString(event.actor);
+        CharacterDatabase.EscapeString(event.reason);
+
+        historySql += historyRows ? ", " : "INSERT INTO guild_bans_history (eventDate, guildId, guid, accountId, action, banType, actor, reason, unbanDate) VALUES ";
+        historySql += Acore::StringFormat("({}, {}, {}, {}, {}, {}, '{}', '{}', {})",
+            event.date, event.guildId, event.guid, event.accountId, static_cast<uint8>(event.action),
+            static_cast<uint8>(event.banType), event.actor, event.reason, event.unbanDate);
+
+        if (++historyRows == MaxRowsPerStatement)
+        {
+            trans->Append(historySql);
+            historySql.clear();
+            historyRows = 0;
+        }
+    }
+
+    if (historyRows)
+        trans->Append(historySql);
+
+    _stats.Increment(GUILD_BAN_COUNTER_ROWS_WRITTEN, _pendingWrites.size() + _pendingHistory.size());
+    _pendingHistory.clear();
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (synchronous)
+    {
+        _pendingWrites.clear();
+        CharacterDatabase.DirectCommitTransaction(trans);
+        _stats.Record(GUILD_BAN_TIMER_DB_WRITE, std::chrono::steady_clock::now() - start);
+        return;
+    }
+
+    // Until the commit lands, SyncFromDB would read these rows back in their old state
+    std::vector<uint64> keys;
+    keys.reserve(_pendingWrites.size());
+
+    for (auto const& [key, write] : _pendingWrites)
+    {
+        keys.push_back(key);
+        ++_inFlightWrites.FindOrInsert(key);
+    }
+
+    _pendingWrites.clear();
+
+    _transactionCallbacks.AddCallback(CharacterDatabase.AsyncCommitTransaction(trans).AfterComplete([this, start, keys = std::move(keys)](bool success)
+    {
+        _stats.Record(GUILD_BAN_TIMER_DB_WRITE, std::chrono::steady_clock::now() - start);
+
+        if (!success)
+            _stats.Increment(GUILD_BAN_COUNTER_WRITES_FAILED);
+
+        for (uint64 key : keys)
+            if (!--*_inFlightWrites.Find(key))
+                _inFlightWrites.Erase(key);
+    }));
+}
+
+void GuildBanMgr::ProcessExpiredBans()
+{
+    uint32 now = time(nullptr);
+
+    if (_expiryQueue.empty() || _expiryQueue.top().unbanDate > now)
+        return;
+
+    // Bans imported with one duration run out in the same tick, they are lifted with one index publish
+    // and one database flush like RemoveBans
+    GuildBanIndex::Writer writer(_index);
+    uint32 removed = 0;
+
+    // Only due entries are touched; entries whose ban was lifted or replaced since are dropped
+    while (!_expiryQueue.empty() && _expiryQueue.top().unbanDate <= now)
+    {
+        GuildBanExpiry expiry = _expiryQueue.top();
+        _expiryQueue.pop();
+
+        Optional<GuildBanEntry> ban = GetBan(expiry.guildId, expiry.guid);
+        if (!ban || ban->unbanDate != expiry.unbanDate)
+            continue;
+
+        LOG_DEBUG("module", "Guild ban of guid {} in guild {} expired", expiry.guid, expiry.guildId);
+
+        if (EraseBan(expiry.guildId, expiry.guid, GUILD_BAN_HISTORY_EXPIRE, "", writer))
+            ++removed;
+
+        QueueWrite(GUILD_BAN_WRITE_DELETE, expiry.guildId, expiry.guid, GuildBanInfo());
+    }
+
+    writer.Commit();
+
+    if (!removed)
+        return;
+
+    FlushPendingWrites();
+    _stats.Increment(GUILD_BAN_COUNTER_BAN_REMOVED, removed);
+}
+
+void GuildBanMgr::PurgeGuild(uint32 guildId)
+{
+    bool subscribed = _subscriptions.contains(guildId);
+
+    GuildBanIndex::Writer writer(_index);
+    uint32 removed = DropGuild(guildId, writer);
+    writer.Commit();
+
+    if (!removed && !subscribed)
+        return;
+
+    CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+
+    if (subscribed)
+        trans->Append("DELETE FROM guild_ban_list_subscriptions WHERE guildId = {}", guildId);
+
+    // guid 0 tells the other worldservers to drop the whole guild, subscriptions included
+    if (_changeLogEnabled)
+        trans->Append("INSERT INTO guild_bans_log (guildId, guid) VALUES ({}, 0)", guildId);
+
+    CharacterDatabase.CommitTransaction(trans);
+
+    if (!removed)
+        return;
+
+    RecordHistory({ uint32(time(nullptr)), guildId, 0, 0, 0, GUILD_BAN_HISTORY_PURGE, GUILD_BAN_CHARACTER, "", "" });
+
+    LOG_DEBUG("module", "Purging {} bans of disbanded guild {}", removed, guildId);
+}
+
+uint32 GuildBanMgr::DropGuild(uint32 guildId, GuildBanIndex::Writer& writer)
+{
+    if (_subscriptions.erase(guildId))
+        writer.SetSubscriptions(std::make_shared<GuildBanSubscriptions const>(_subscriptions));
+
+    // Queued saves would insert rows of the guild again
+    for (auto it = _pendingWrites.begin(); it != _pendingWrites.end();)
+    {
+        if (GuildBanKeyGuildId(it->first) == guildId)
+            it = _pendingWrites.erase(it);
+        else
+            ++it;
+    }
+
+    uint32 removed = _bans.EraseGuild(guildId, writer);
+    ForgetGuildDetails(guildId);
+    if (!removed)
+        return 0;
+
+    // Every worldserver that drops the guild deletes its rows, the deletes are idempotent and
+    // keep its own consistency check from loading them back meanwhile
+    _stats.Increment(GUILD_BAN_COUNTER_BAN_REMOVED, removed);
+    _guildPurges.emplace_back(guildId, removed);
+    return removed;
+}
+
+void GuildBanMgr::PurgeCharacter(uint32 guid)
+{
+    // Account bans stay, the account can still join with its other characters
+    std::vector<uint32> guildIds;
+    _bans.ForEachOfCharacter(guid, [&](GuildBanEntry const& ban)
+    {
+        if (ban.banType == GUILD_BAN_CHARACTER)
+            guildIds.push_back(ban.guildId);
+    });
+
+    if (guildIds.empty())
+        return;
+
+    GuildBanIndex::Writer writer(_index);
+
+    for (uint32 guildId : guildIds)
+    {
+        EraseBan(guildId, guid, GUILD_BAN_HISTORY_PURGE, "", writer);
+        QueueWrite(GUILD_BAN_WRITE_DELETE, guildId, guid, GuildBanInfo());
+    }
+
+    writer.Commit();
+    _stats.Increment(GUILD_BAN_COUNTER_BAN_REMOVED, guildIds.size());
+}
+
+void GuildBanMgr::PurgeOrphans()
+{
+    std::vector<uint32> guildIds;
+    std::vector<std::pair<uint32, uint32>> characterBans;
+    uint32 lastGuildId = 0;
+    uint32 existingGuilds = 0;
+
+    _bans.ForEach([&](GuildBanEntry const& ban)
+    {
+        // ForEach visits the bans of one guild in a row
+        if (ban.guildId != lastGuildId)
+        {
+            lastGuildId = ban.guildId;
+
+            if (IsGuildBanListGuildId(ban.guildId))
+            {
+                // Bans of shared lists whose list row is gone
+                if (!_sharedLists.contains(ban.guildId & ~GuildBanListFlag))
+                    guildIds.push_back(ban.guildId);
+            }
+            else if (sGuildMgr->GetGuildById(ban.guildId))
+                ++existingGuilds;
+            else
+                guildIds.push_back(ban.guildId);
+        }
+
+        if (ban.banType == GUILD_BAN_CHARACTER && !sCharacterCache->GetCharacterCacheByGuid(ObjectGuid::Create<HighGuid::Player>(ban.guid)))
+            characterBans.emplace_back(ban.guildId, ban.guid);
+    });
+
+    // Not a single banning guild left looks like guilds were not loaded, rather than all of them being gone
+    if (!guildIds.empty() && !existingGuilds)
+    {
+        LOG_WARN("module", "Guild ban orphan sweep skipped: none of the {} guilds with bans exists", guildIds.size());
+        return;
+    }
+
+    for (uint32 guildId : guildIds)
+        PurgeGuild(guildId);
+
+    GuildBanIndex::Writer writer(_index);
+    uint32 removed = 0;
+
+    for (auto const& [guildId, guid] : characterBans)
+    {
+        if (EraseBan(guildId, guid, GUILD_BAN_HISTORY_PURGE, "", writer))
+        {
+            QueueWrite(GUILD_BAN_WRITE_DELETE, guildId, guid, GuildBanInfo());
+            ++removed;
+        }
+    }
+
+    writer.Commit();
+    _stats.Increment(GUILD_BAN_COUNTER_BAN_REMOVED, removed);
+
+    if (!guildIds.empty() || removed)
+        LOG_INFO("module", ">> Guild ban orphan sweep: purging bans of {} missing guilds and {} bans of deleted characters",
+            guildIds.size(), removed);
+}
+
+void GuildBanMgr::ProcessGuildPurges()
+{
+    if (_guildPurges.empty())
+        return;
+
+    // One bounded statement per interval keeps the purge of huge guilds from stalling the database
+    auto& [guildId, rowsLeft] = _guildPurges.front();
+    CharacterDatabase.Execute("DELETE FROM guild_bans WHERE guildId = {} LIMIT {}", guildId, _purgeChunkSize);
+
+    if (rowsLeft > _purgeChunkSize)
+        rowsLeft -= _purgeChunkSize;
+    else
+        _guildPurges.pop_front();
+}
+
+void GuildBanMgr::ProcessPendingKicks()
+{
+    if (_pendingKicks.empty())
+        return;
+
+    // Grouped per guild, each guild gets one roster update
+    std::sort(_pendingKicks.begin(), _pendingKicks.end());
+
+    std::vector<ObjectGuid> guids;
+    for (auto it = _pendingKicks.begin(); it != _pendingKicks.end();)
+    {
+        uint32 guildId = it->first;
+        guids.clear();
+
+        for (; it != _pendingKicks.end() && it->first == guildId; ++it)
+            guids.push_back(it->second);
+
+        if (Guild* guild = sGuildMgr->GetGuildById(guildId))
+            RemoveGuildMembers(guild, guids, false);
+    }
+
+    _pendingKicks.clear();
+}
+
+uint32 GuildBanMgr::RemoveGuildMembers(Guild* guild, std::span<ObjectGuid const> guids, bool isKicking /*= true*/)
+{
+    uint32 removed = 0;
+
+    for (ObjectGuid guid : guids)
+        if (guild->GetMember(guid) && guild->DeleteMember(guid, false, isKicking, false))
+            ++removed;
+
+    // DeleteMember does not tell the other members, their rosters are refreshed once for the batch
+    if (removed)
+        guild->HandleRoster();
+
+    return removed;
+}
+
+void GuildBanMgr::LoadSharedLists()
+{
+    _nextSharedListId = 1;
+
+    SetSharedLists(CharacterDatabase.Query("SELECT listId, name, ownerGuildId FROM guild_ban_lists"),
+                   CharacterDatabase.Query("SELECT guildId, listId FROM guild_ban_list_subscriptions"));
+
+    LOG_INFO("module", ">> Loaded {} shared guild ban lists, subscribed to by {} guilds", _sharedLists.size(), _subscriptions.size());
+}
+
+void GuildBanMgr::ReloadSharedLists()
+{
+    _changeLogPollInProgress = true;
+
+    auto lists = std::make_shared<QueryResult>();
+
+    _queryProcessor.AddCallback(CharacterDatabase.AsyncQuery("SELECT listId, name, ownerGuildId FROM guild_ban_lists")
+        .WithChainingCallback([lists](QueryCallback& callback, QueryResult result)
+        {
+            *lists = std::move(result);
+            callback.SetNextQuery(CharacterDatabase.AsyncQuery("SELECT guildId, listId FROM guild_ban_list_subscriptions"));
+        })
+        .WithCallback([this, lists](QueryResult result)
+        {
+            _changeLogPollInProgress = false;
+
+            SetSharedLists(std::move(*lists), std::move(result));
+            LOG_DEBUG("module", "Guild ban change log: reloaded {} shared lists, subscribed to by {} guilds",
+                _sharedLists.size(), _subscriptions.size());
+        }));
+}
+
+void GuildBanMgr::SetSharedLists(QueryResult lists, QueryResult subscriptions)
+{
+    _sharedLists.clear();
+    _sharedListIds.clear();
+    _subscriptions.clear();
+
+    if (lists)
+    {
+        do
+        {
+            Field* fields = lists->Fetch();
+
+            GuildBanList list;
+            list.id           = fields[0].Get<uint32>();
+            list.name         = fields[1].Get<std::string>();
+            list.ownerGuildId = fields[2].Get<uint32>();
+
+            std::string key = list.name;
+            strToLower(key);
+
+            _sharedListIds[key] = list.id;
+            _nextSharedListId = std::max(_nextSharedListId, list.id + 1);
+            _sharedLists.emplace(list.id, std::move(list));
+
+        } while (lists->NextRow());
+    }
+
+    if (subscriptions)
+    {
+        do
+        {
+            Field* fields = subscriptions->Fetch();
+            uint32 listId = fields[1].Get<uint32>();
+
+            if (_sharedLists.contains(listId))
+                _subscriptions[fields[0].Get<uint32>()].push_back(MakeGuildBanListGuildId(listId));
+
+        } while (subscriptions->NextRow());
+    }
+
+    PublishSubscriptions();
+}
+
+void GuildBanMgr::PublishSubscriptions()
+{
+    // Copy on write: lookups keep reading the previous map until the swap
+    GuildBanIndex::Writer writer(_index);
+    writer.SetSubscriptions(std::make_shared<GuildBanSubscriptions const>(_subscriptions));
+    writer.Commit();
+}
+
+GuildBanList const* GuildBanMgr::GetSharedList(std::string_view name) const
+{
+    std::string key(name);
+    strToLower(key);
+
+    auto itr = _sharedListIds.find(key);
+    return itr != _sharedListIds.end() ? GetSharedList(itr->second) : nullptr;
+}
+
+GuildBanList const* GuildBanMgr::GetSharedList(uint32 listId) const
+{
+    auto itr = _sharedLists.find(listId);
+    return itr != _sharedLists.end() ? &itr->second : nullptr;
+}
+
+GuildBanList const* GuildBanMgr::CreateSharedList(std::string_view name, uint32 ownerGuildId)
+{
+    std::string key(name);
+    strToLower(key);
+
+    if (_sharedListIds.contains(key))
+        return nullptr;
+
+    uint32 listId = _nextSharedListId++;
+    _sharedListIds.emplace(std::move(key), listId);
+    GuildBanList& list = _sharedLists[listId] = { listId, std::string(name), ownerGuildId };
+
+    std::string escapedName = list.name;
+    CharacterDatabase.EscapeString(escapedName);
+
+    CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+    trans->Append("INSERT INTO guild_ban_lists (listId, name, ownerGuildId) VALUES ({}, '{}', {})", listId, escapedName, ownerGuildId);
+    CommitSharedListChange(trans, MakeGuildBanListGuildId(listId));
+
+    return &list;
+}
+
+void GuildBanMgr::DeleteSharedList(uint32 listId)
+{
+    auto itr = _sharedLists.find(listId);
+    if (itr == _sharedLists.end())
+        return;
+
+    uint32 listGuildId = MakeGuildBanListGuildId(listId);
+
+    for (auto subscription = _subscriptions.begin(); subscription != _subscriptions.end();)
+    {
+        std::erase(subscription->second, listGuildId);
+
+        if (subscription->second.empty())
+            subscription = _subscriptions.erase(subscription);
+        else
+            ++subscription;
+    }
+
+    PublishSubscriptions();
+    PurgeGuild(listGuildId);
+
+    std::string key = itr->second.name;
+    strToLower(key);
+    _sharedListIds.erase(key);
+    _sharedLists.erase(itr);
+
+    CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+    trans->Append("DELETE FROM guild_ban_list_subscriptions WHERE listId = {}", listId);
+    trans->Append("DELETE FROM guild_ban_lists WHERE listId = {}", listId);
+    CommitSharedListChange(trans, listGuildId);
+}
+
+bool GuildBanMgr::Subscribe(uint32 guildId, uint32 listId)
+{
+    if (!_sharedLists.contains(listId))
+        return false;
+
+    std::vector<uint32>& lists = _subscriptions[guildId];
+    uint32 listGuildId = MakeGuildBanListGuildId(listId);
+
+    if (std::find(lists.begin(), lists.end(), listGuildId) != lists.end())
+        return false;
+
+    lists.push_back(listGuildId);
+    PublishSubscriptions();
+
+    CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+    trans->Append("INSERT IGNORE INTO guild_ban_list_subscriptions (guildId, listId) VALUES ({}, {})", guildId, listId);
+    CommitSharedListChange(trans, guildId);
+    return true;
+}
+
+bool GuildBanMgr::Unsubscribe(uint32 guildId, uint32 listId)
+{
+    auto itr = _subscriptions.find(guildId);
+    if (itr == _subscriptions.end() || !std::erase(itr->second, MakeGuildBanListGuildId(listId)))
+        return false;
+
+    if (itr->second.empty())
+        _subscriptions.erase(itr);
+
+    PublishSubscriptions();
+
+    CharacterDatabaseTransaction trans = CharacterDatabase.BeginTransaction();
+    trans->Append("DELETE FROM guild_ban_list_subscriptions WHERE guildId = {} AND listId = {}", guildId, listId);
+    CommitSharedListChange(trans, guildId);
+    return true;
 }
 
-void GuildBanMgr::LoadFromDB()
+void GuildBanMgr::CommitSharedListChange(CharacterDatabaseTransaction trans, uint32 guildId)
 {
-    uint32 oldMSTime = getMSTime();
+    if (_changeLogEnabled)
+        trans->Append("INSERT INTO guild_bans_log (guildId, guid, type) VALUES ({}, 0, {})", guildId, uint32(GUILD_BAN_LOG_SHARED_LISTS));
+
+    CharacterDatabase.CommitTransaction(trans);
+}
 
-    _characterBans.clear();
-    _accountBans.clear();
-    _banInfo.clear();
+std::vector<uint32> GuildBanMgr::GetSubscriptions(uint32 guildId) const
+{
+    std::vector<uint32> listIds;
+
+    auto itr = _subscriptions.find(guildId);
+    if (itr != _subscriptions.end())
+        for (uint32 listGuildId : itr->second)
+            listIds.push_back(listGuildId & ~GuildBanListFlag);
+
+    return listIds;
+}
 
-    QueryResult result = CharacterDatabase.Query("SELECT guildId, guid, accountId, banDate, unbanDate, bannedBy, banReason, banType FROM guild_bans");
+bool GuildBanMgr::ConsumeJoinAttempt(uint32 guildId, uint32 guid)
+{
+    if (!_joinThrottleRefill)
+        return true;
+
+    uint32 now = getMSTime();
+    auto [itr, inserted] = _joinBuckets.try_emplace(MakeGuildBanKey(guildId, guid), GuildBanJoinBucket{ _joinThrottleBurst, now });
+    GuildBanJoinBucket& bucket = itr->second;
 
-    if (!result)
+    if (!inserted)
     {
-        LOG_INFO("module", ">> Loaded 0 guild bans. Table `guild_bans` is empty.");
+        uint32 refills = getMSTimeDiff(bucket.lastRefill, now) / _joinThrottleRefill;
+        if (refills)
+        {
+            bucket.tokens = std::min(_joinThrottleBurst, bucket.tokens + refills);
+            bucket.lastRefill += refills * _joinThrottleRefill;
+        }
+    }
+
+    if (!bucket.tokens)
+        return false;
+
+    // A full bucket refills from the moment it is first drawn from
+    if (bucket.tokens == _joinThrottleBurst)
+        bucket.lastRefill = now;
+
+    --bucket.tokens;
+    return true;
+}
+
+void GuildBanMgr::RecordJoinAttempt(uint32 guildId, uint32 guid)
+{
+    if (!_notifyOnBannedJoinAttempt)
         return;
+
+    ++_joinAttempts[guildId][guid];
+
+    if (!_joinDigestInterval)
+        SendJoinAttemptDigests();
+}
+
+void GuildBanMgr::SendJoinAttemptDigests()
+{
+    for (auto const& [guildId, attempts] : _joinAttempts)
+    {
+        Guild* guild = sGuildMgr->GetGuildById(guildId);
+        if (!guild)
+            continue;
+
+        std::string names;
+        for (auto const& [guid, count] : attempts)
+        {
+            std::string name = "Unknown";
+            if (CharacterCacheEntry const* entry = sCharacterCache->GetCharacterCacheByGuid(ObjectGuid::Create<HighGuid::Player>(guid)))
+                name = entry->Name;
+
+            if (!names.empty())
+                names += ", ";
+
+            names += count > 1 ? Acore::StringFormat("{} ({}x)", name, count) : name;
+        }
+
+        std::string message = Acore::StringFormat("|cffff0000[Guild Ban]|r Banned {} attempted to join the guild: {}",
+                                                  attempts.size() > 1 ? "players" : "player", names);
+
+        // Everyone who may lift the ban: the leader, and the officers when they may ban too
+        auto notify = [&](Player* member)
+        {
+            bool canBan = guild->GetLeaderGUID() == member->GetGUID();
+
+            if (!canBan && _allowOfficerBan)
+                if (Guild::Member const* rank = guild->GetMember(member->GetGUID()))
+                    canBan = rank->GetRankId() <= 1;
+
+            if (canBan)
+                ChatHandler(member->GetSession()).SendSysMessage(message);
+        };
+
+        guild->BroadcastWorker(notify);
     }
 
-    uint32 count = 0;
+    _joinAttempts.clear();
+}
+
+void GuildBanMgr::PruneJoinBuckets()
+{
+    uint32 now = getMSTime();
+    uint32 fullAfter = _joinThrottleBurst * _joinThrottleRefill;
+
+    for (auto itr = _joinBuckets.begin(); itr != _joinBuckets.end();)
+    {
+        if (getMSTimeDiff(itr->second.lastRefill, now) >= fullAfter)
+            itr = _joinBuckets.erase(itr);
+        else
+            ++itr;
+    }
+}
 
-    do
+void GuildBanMgr::GetAccountCharacters(uint32 accountId, std::function<void(std::vector<uint32> const&)> callback)
+{
+    auto it = _accountCharacters.find(accountId);
+    if (it != _accountCharacters.end())
     {
-        Field* fields = result->Fetch();
+        _accountCharacterLru.splice(_accountCharacterLru.begin(), _accountCharacterLru, it->second.lru);
+        callback(it->second.guids);
+        return;
+    }
 
-        GuildBanInfo info;
-        info.guildId    = fields[0].Get<uint32>();
-        info.guid       = fields[1].Get<uint32>();
-        info.accountId  = fields[2].Get<uint32>();
-        info.banDate    = fields[3].Get<uint32>();
-        info.unbanDate  = fields[4].Get<uint32>();
-        info.bannedBy   = fields[5].Get<std::string>();
-        info.banReason  = fields[6].Get<std::string>();
-        info.banType    = static_cast<GuildBanType>(fields[7].Get<uint8>());
-
-        // Check if ban has expired
-        if (info.unbanDate != 0 && info.unbanDate < time(nullptr))
+    // The first request starts the query, later ones only queue their callback
+    auto& waiters = _accountCharacterWaiters[accountId];
+    waiters.push_back(std::move(callback));
+    if (waiters.size() > 1)
+        return;
+
+    _queryProcessor.AddCallback(CharacterDatabase.AsyncQuery("SELECT guid FROM characters WHERE account = {}", accountId)
+        .WithCallback([this, accountId](QueryResult result)
         {
-            // Remove expired ban
-            CharacterDatabase.Execute("DELETE FROM guild_bans WHERE guildId = {} AND guid = {}", info.guildId, info.guid);
-            continue;
+            std::vector<uint32> guids;
+
+            if (result)
+            {
+                do
+                {
+                    guids.push_back(result->Fetch()[0].Get<uint32>());
+                } while (result->NextRow());
+            }
+
+            auto [it, inserted] = _accountCharacters.try_emplace(accountId);
+            if (inserted)
+            {
+                _accountCharacterLru.push_front(accountId);
+                it->second.lru = _accountCharacterLru.begin();
+            }
+
+            it->second.guids = guids;
+
+            if (_accountCharacters.size() > AccountCacheSize)
+            {
+                _accountCharacters.erase(_accountCharacterLru.back());
+                _accountCharacterLru.pop_back();
+            }
+
+            auto waiters = _accountCharacterWaiters.extract(accountId);
+            for (auto const& callback : waiters.mapped())
+                callback(guids);
+        }));
+}
+
+void GuildBanMgr::AddAccountCharacter(uint32 accountId, uint32 guid)
+{
+    auto it = _accountCharacters.find(accountId);
+    if (it == _accountCharacters.end())
+        return;
+
+    std::vector<uint32>& guids = it->second.guids;
+    if (std::find(guids.begin(), guids.end(), guid) == guids.end())
+        guids.push_back(guid);
+}
+
+void GuildBanMgr::RemoveAccountCharacter(uint32 accountId, uint32 guid)
+{
+    auto it = _accountCharacters.find(accountId);
+    if (it == _accountCharacters.end())
+        return;
+
+    std::vector<uint32>& guids = it->second.guids;
+    guids.erase(std::remove(guids.begin(), guids.end(), guid), guids.end());
+}
+
+void GuildBanMgr::Update(uint32 diff)
+{
+    _queryProcessor.ProcessReadyCallbacks();
+    _transactionCallbacks.ProcessReadyCallbacks();
+
+    _expiryTimer += diff;
+
+    if (_expiryTimer >= ExpiryCheckInterval)
+    {
+        _expiryTimer = 0;
+        ProcessExpiredBans();
+    }
+
+    _flushTimer += diff;
+
+    if (_flushTimer >= _writeFlushInterval)
+        FlushPendingWrites();
+
+    ProcessPendingKicks();
+    UpdateVerify(diff);
+
+    _joinDigestTimer += diff;
+
+    if (_joinDigestTimer >= std::max(_joinDigestInterval, ExpiryCheckInterval))
+    {
+        _joinDigestTimer = 0;
+        SendJoinAttemptDigests();
+        PruneJoinBuckets();
+    }
+
+    _purgeTimer += diff;
+
+    if (_purgeTimer >= _purgeInterval)
+    {
+        _purgeTimer = 0;
+        ProcessGuildPurges();
+        ProcessHistoryPrune();
+    }
+
+    _historyPruneTimer += diff;
+
+    if (_historyPruneTimer >= HistoryPruneInterval)
+    {
+        _historyPruneTimer = 0;
+        PruneHistory();
+    }
+
+    if (_changeLogEnabled)
+    {
+        _changeLogTimer += diff;
+
+        if (_changeLogTimer >= _changeLogPollInterval)
+        {
+            _changeLogTimer = 0;
+            PollChangeLog();
         }
+    }
 
-        _characterBans[info.guildId].insert(info.guid);
+    if (_syncInterval)
+    {
+        _syncTimer += diff;
 
-        if (info.banType == GUILD_BAN_ACCOUNT && info.accountId > 0)
+        if (_syncTimer >= _syncInterval)
         {
-            _accountBans[info.guildId].insert(info.accountId);
+            _syncTimer = 0;
+            SyncFromDB();
         }
+    }
+
+    if (!_snapshotFile.empty() && _snapshotInterval)
+    {
+        _snapshotTimer += diff;
 
-        _banInfo[info.guildId].push_back(info);
-        ++count;
+        if (_snapshotTimer >= _snapshotInterval)
+        {
+            _snapshotTimer = 0;
+            SaveSnapshot();
+        }
+    }
 
-    } while (result->NextRow());
+    if (_statsLogInterval)
+    {
+        _statsLogTimer += diff;
 
-    LOG_INFO("module", ">> Loaded {} guild bans in {} ms", count, GetMSTimeDiffToNow(oldMSTime));
+        if (_statsLogTimer >= _statsLogInterval)
+        {
+            _statsLogTimer = 0;
+            LogStats();
+        }
+    }
 }
 
-void GuildBanMgr::SaveBanToDB(GuildBanInfo const& banInfo)
+GuildBanMemoryStats GuildBanMgr::GetMemoryStats() const
 {
-    CharacterDatabase.Execute(
-        "REPLACE INTO guild_bans (guildId, guid, accountId, banDate, unbanDate, bannedBy, banReason, banType) "
-        "VALUES ({}, {}, {}, {}, {}, '{}', '{}', {})",
-        banInfo.guildId, banInfo.guid, banInfo.accountId, banInfo.banDate, banInfo.unbanDate,
-        banInfo.bannedBy, banInfo.banReason, static_cast<uint8>(banInfo.banType));
+    GuildBanMemoryStats stats;
+    stats.index = _index.MemoryUsage();
+    stats.store = _bans.MemoryUsage();
+    stats.accountCache = _accountCharacters.bucket_count() * sizeof(void*);
+    stats.history = _history.MemoryUsage() + _pendingHistory.capacity() * sizeof(GuildBanHistoryEvent);
+    stats.guildDetails = _detailBytes;
+    stats.detailGuilds = _detailGuilds.size();
+    stats.bans = _bans.Size();
+    stats.pendingWrites = _pendingWrites.size();
+    stats.cachedAccounts = _accountCharacters.size();
+
+    for (auto const& [accountId, characters] : _accountCharacters)
+        stats.accountCache += sizeof(accountId) + sizeof(characters) + 5 * sizeof(void*) + characters.guids.capacity() * sizeof(uint32);
+
+    return stats;
 }
 
-void GuildBanMgr::RemoveBanFromDB(uint32 guildId, uint32 guid)
+void GuildBanMgr::LogStats() const
 {
-    CharacterDatabase.Execute("DELETE FROM guild_bans WHERE guildId = {} AND guid = {}", guildId, guid);
+    GuildBanHistogram::Summary lookup = _stats.Summarize(GUILD_BAN_TIMER_LOOKUP);
+    GuildBanHistogram::Summary join = _stats.Summarize(GUILD_BAN_TIMER_JOIN_CHECK);
+    GuildBanHistogram::Summary write = _stats.Summarize(GUILD_BAN_TIMER_DB_WRITE);
+    GuildBanMemoryStats memory = GetMemoryStats();
+
+    LOG_INFO("module", "Guild ban stats: {} lookups ({} hits, p99 {}), {} joins rejected (check p99 {}), "
+        "{} bans added, {} removed, {} rows written (commit p99 {}, {} failed), {} bans in {} KB",
+        _stats.Get(GUILD_BAN_COUNTER_LOOKUP_HIT) + _stats.Get(GUILD_BAN_COUNTER_LOOKUP_MISS), _stats.Get(GUILD_BAN_COUNTER_LOOKUP_HIT),
+        FormatGuildBanLatency(lookup.p99), _stats.Get(GUILD_BAN_COUNTER_JOIN_REJECTED), FormatGuildBanLatency(join.p99),
+        _stats.Get(GUILD_BAN_COUNTER_BAN_ADDED), _stats.Get(GUILD_BAN_COUNTER_BAN_REMOVED), _stats.Get(GUILD_BAN_COUNTER_ROWS_WRITTEN),
+        FormatGuildBanLatency(write.p99), _stats.Get(GUILD_BAN_COUNTER_WRITES_FAILED),
+        memory.bans, (memory.index + memory.store + memory.accountCache + memory.history) / 1024);
 }
 
 bool GuildBanMgr::AddBan(uint32 guildId, uint32 guid, uint32 accountId, std::string const& bannedBy,
                           std::string const& reason, uint32 duration, GuildBanType banType)
 {
+    GuildBanScopedTimer timer(_stats, GUILD_BAN_TIMER_ADD_BAN);
+
     GuildBanInfo info;
     info.guildId    = guildId;
     info.guid       = guid;
@@ -124,94 +1547,201 @@ bool GuildBanMgr::AddBan(uint32 guildId, uint32 guid, uint32 accountId, std::str
     info.banReason  = reason;
     info.banType    = banType;
 
-    _characterBans[guildId].insert(guid);
+    // Re-banning an already banned character replaces its record
+    GuildBanIndex::Writer writer(_index);
+    _bans.Set(info, writer);
+    writer.Commit();
 
-    if (banType == GUILD_BAN_ACCOUNT && accountId > 0)
-    {
-        _accountBans[guildId].insert(accountId);
-    }
+    if (info.unbanDate)
+        _expiryQueue.push({ info.unbanDate, guildId, guid });
 
-    _banInfo[guildId].push_back(info);
+    RecordHistory(info);
     SaveBanToDB(info);
+    _stats.Increment(GUILD_BAN_COUNTER_BAN_ADDED);
 
     return true;
 }
 
-bool GuildBanMgr::RemoveBan(uint32 guildId, uint32 guid)
+uint32 GuildBanMgr::AddBans(std::span<GuildBanInfo const> bans)
 {
-    auto charIt = _characterBans.find(guildId);
-    if (charIt != _characterBans.end())
+    GuildBanIndex::Writer writer(_index);
+
+    for (GuildBanInfo const& info : bans)
     {
-        charIt->second.erase(guid);
+        _bans.Set(info, writer);
+
+        if (info.unbanDate)
+            _expiryQueue.push({ info.unbanDate, info.guildId, info.guid });
+
+        RecordHistory(info);
+        QueueWrite(GUILD_BAN_WRITE_SAVE, info.guildId, info.guid, info);
     }
 
-    auto infoIt = _banInfo.find(guildId);
-    if (infoIt != _banInfo.end())
+    writer.Commit();
+    FlushPendingWrites();
+
+    _stats.Increment(GUILD_BAN_COUNTER_BAN_ADDED, bans.size());
+    return bans.size();
+}
+
+uint32 GuildBanMgr::RemoveBans(uint32 guildId, std::span<uint32 const> guids, std::string const& removedBy /*= ""*/)
+{
+    GuildBanIndex::Writer writer(_index);
+    uint32 removed = 0;
+
+    for (uint32 guid : guids)
     {
-        auto& bans = infoIt->second;
-        for (auto it = bans.begin(); it != bans.end(); ++it)
-        {
-            if (it->guid == guid)
-            {
-                if (it->banType == GUILD_BAN_ACCOUNT && it->accountId > 0)
-                {
-                    auto accIt = _accountBans.find(guildId);
-                    if (accIt != _accountBans.end())
-                    {
-                        accIt->second.erase(it->accountId);
-                    }
-                }
-                bans.erase(it);
-                break;
-            }
-        }
+        if (EraseBan(guildId, guid, GUILD_BAN_HISTORY_UNBAN, removedBy, writer))
+            ++removed;
+
+        QueueWrite(GUILD_BAN_WRITE_DELETE, guildId, guid, GuildBanInfo());
     }
 
+    writer.Commit();
+    FlushPendingWrites();
+
+    _stats.Increment(GUILD_BAN_COUNTER_BAN_REMOVED, removed);
+    return removed;
+}
+
+bool GuildBanMgr::RemoveBan(uint32 guildId, uint32 guid, std::string const& removedBy /*= ""*/,
+                             GuildBanHistoryAction action /*= GUILD_BAN_HISTORY_UNBAN*/)
+{
+    GuildBanScopedTimer timer(_stats, GUILD_BAN_TIMER_REMOVE_BAN);
+
+    GuildBanIndex::Writer writer(_index);
+    bool removed = EraseBan(guildId, guid, action, removedBy, writer);
+    writer.Commit();
+
     RemoveBanFromDB(guildId, guid);
-    return true;
+
+    if (removed)
+        _stats.Increment(GUILD_BAN_COUNTER_BAN_REMOVED);
+
+    return removed;
+}
+
+bool GuildBanMgr::EraseBan(uint32 guildId, uint32 guid, GuildBanHistoryAction action, std::string_view actor,
+                           GuildBanIndex::Writer& writer)
+{
+    Optional<GuildBanEntry> ban = _bans.Find(guildId, guid);
+    if (!ban)
+        return false;
+
+    RecordHistory({ uint32(time(nullptr)), guildId, guid, ban->accountId, ban->unbanDate, action, ban->banType,
+                    std::string(actor), std::string(ban->banReason) });
+
+    return _bans.Erase(guildId, guid, writer);
+}
+
+void GuildBanMgr::RecordHistory(GuildBanHistoryEvent&& event)
+{
+    if (!_historyEnabled)
+        return;
+
+    _history.Push(event);
+    _pendingHistory.push_back(std::move(event));
+}
+
+void GuildBanMgr::RecordHistory(GuildBanInfo const& info)
+{
+    RecordHistory({ info.banDate, info.guildId, info.guid, info.accountId, info.unbanDate, GUILD_BAN_HISTORY_BAN,
+                    info.banType, info.bannedBy, info.banReason });
+}
+
+void GuildBanMgr::PruneHistory()
+{
+    // A pass still running covers older rows already
+    if (!_historyRetentionDays || _historyPruneRows)
+        return;
+
+    uint32 before = uint32(time(nullptr)) - _historyRetentionDays * DAY;
+
+    _queryProcessor.AddCallback(CharacterDatabase.AsyncQuery(
+        "SELECT CAST(COUNT(*) AS UNSIGNED) FROM guild_bans_history WHERE eventDate < {}", before)
+        .WithCallback([this, before](QueryResult result)
+        {
+            if (!result || !result->Fetch()[0].Get<uint64>())
+                return;
+
+            _historyPruneRows = result->Fetch()[0].Get<uint64>();
+            _historyPruneBefore = before;
+
+            LOG_DEBUG("module", "Pruning {} guild ban history events older than {} days", _historyPruneRows, _historyRetentionDays);
+        }));
+}
+
+void GuildBanMgr::ProcessHistoryPrune()
+{
+    if (!_historyPruneRows)
+        return;
+
+    // Bounded like the guild purges, the table takes an insert on every ban change meanwhile
+    CharacterDatabase.Execute("DELETE FROM guild_bans_history WHERE eventDate < {} LIMIT {}", _historyPruneBefore, _purgeChunkSize);
+    _historyPruneRows -= std::min<uint64>(_historyPruneRows, _purgeChunkSize);
+}
+
+bool GuildBanMgr::CountLookup(bool banned) const
+{
+    _stats.Increment(banned ? GUILD_BAN_COUNTER_LOOKUP_HIT : GUILD_BAN_COUNTER_LOOKUP_MISS);
+    return banned;
 }
 
 bool GuildBanMgr::IsCharacterBanned(uint32 guildId, uint32 guid) const
 {
-    auto it = _characterBans.find(guildId);
-    if (it != _characterBans.end())
-    {
-        return it->second.find(guid) != it->second.end();
-    }
-    return false;
+    GuildBanScopedTimer timer(_stats, GUILD_BAN_TIMER_LOOKUP, GuildBanStats::SampleLookup());
+    return CountLookup(_index.ContainsCharacter(MakeGuildBanKey(guildId, guid)));
 }
 
 bool GuildBanMgr::IsAccountBanned(uint32 guildId, uint32 accountId) const
 {
-    auto it = _accountBans.find(guildId);
-    if (it != _accountBans.end())
-    {
-        return it->second.find(accountId) != it->second.end();
-    }
-    return false;
+    GuildBanScopedTimer timer(_stats, GUILD_BAN_TIMER_LOOKUP, GuildBanStats::SampleLookup());
+    return CountLookup(accountId && _index.ContainsAccount(MakeGuildBanKey(guildId, accountId)));
 }
 
 bool GuildBanMgr::IsBanned(uint32 guildId, uint32 guid, uint32 accountId) const
 {
-    return IsCharacterBanned(guildId, guid) || IsAccountBanned(guildId, accountId);
+    GuildBanScopedTimer timer(_stats, GUILD_BAN_TIMER_LOOKUP, GuildBanStats::SampleLookup());
+    return CountLookup(_index.Contains(MakeGuildBanKey(guildId, guid), MakeGuildBanKey(guildId, accountId)));
 }
 
-std::vector<GuildBanInfo> GuildBanMgr::GetGuildBans(uint32 guildId) const
+std::vector<GuildBanEntry> GuildBanMgr::GetCharacterBans(uint32 guid) const
 {
-    auto it = _banInfo.find(guildId);
-    if (it != _banInfo.end())
-    {
-        return it->second;
-    }
-    return {};
+    std::vector<GuildBanEntry> bans;
+    _bans.ForEachOfCharacter(guid, [&](GuildBanEntry const& ban) { bans.push_back(ban); });
+    return bans;
+}
+
+std::vector<GuildBanEntry> GuildBanMgr::GetAccountBans(uint32 accountId) const
+{
+    std::vector<GuildBanEntry> bans;
+    _bans.ForEachOfAccount(accountId, [&](GuildBanEntry const& ban) { bans.push_back(ban); });
+    return bans;
 }
 
-// Guild Script to intercept player joining
+Optional<GuildBanEntry> GuildBanMgr::GetBan(uint32 guildId, uint32 guid) const
+{
+    return _bans.Find(guildId, guid);
+}
+
+uint32 GuildBanMgr::GetGuildBanPage(uint32 guildId, uint32 offset, uint32 limit, GuildBanSortOrder order,
+                                    std::vector<GuildBanEntry>& page) const
+{
+    return _bans.GetGuildPage(guildId, offset, limit, order, page);
+}
+
+// Guild Script purging bans of disbanded guilds and removing banned players that joined without
+// the client invite flow (e.g. GM commands or other modules); client invites are stopped by GuildBan_ServerScript
 class GuildBan_GuildScript : public GuildScript
 {
 public:
     GuildBan_GuildScript() : GuildScript("GuildBan_GuildScript") { }
 
+    void OnDisband(Guild* guild) override
+    {
+        sGuildBanMgr->PurgeGuild(guild->GetId());
+    }
+
     void OnAddMember(Guild* guild, Player* player, uint8& /*plRank*/) override
     {
         if (!sGuildBanMgr->IsEnabled() || !player || !guild)
@@ -221,33 +1751,116 @@ public:
         uint32 guid = player->GetGUID().GetCounter();
         uint32 accountId = player->GetSession()->GetAccountId();
 
+        GuildBanScopedTimer timer(sGuildBanMgr->GetStats(), GUILD_BAN_TIMER_JOIN_CHECK);
+
         if (sGuildBanMgr->IsBanned(guildId, guid, accountId))
         {
-            // Schedule removal for next update (can't remove during add)
-            player->GetSession()->GetPlayer()->m_Events.AddEventAtOffset([guildId, playerGuid = player->GetGUID()]()
-            {
-                if (Player* p = ObjectAccessor::FindPlayer(playerGuid))
-                {
-                    if (Guild* g = sGuildMgr->GetGuildById(guildId))
-                    {
-                        g->DeleteMember(playerGuid, false, false, false);
-                        ChatHandler(p->GetSession()).PSendSysMessage("You are banned from this guild and cannot join.");
-                    }
-                }
-            }, 100ms);
+            sGuildBanMgr->GetStats().Increment(GUILD_BAN_COUNTER_JOIN_REJECTED);
+            sGuildBanMgr->QueueKick(guildId, player->GetGUID());
+            sGuildBanMgr->RecordJoinAttempt(guildId, guid);
 
-            // Notify guild leader if configured
-            if (sGuildBanMgr->NotifyOnBannedJoinAttempt())
-            {
-                if (Player* leader = ObjectAccessor::FindPlayer(guild->GetLeaderGUID()))
-                {
-                    ChatHandler(leader->GetSession()).PSendSysMessage(
-                        "|cffff0000[Guild Ban]|r Banned player %s attempted to join the guild.",
-                        player->GetName().c_str());
-                }
-            }
+            if (sGuildBanMgr->ConsumeJoinAttempt(guildId, guid))
+                ChatHandler(player->GetSession()).PSendSysMessage("You are banned from this guild and cannot join.");
+        }
+    }
+};
+
+// Server Script rejecting banned players at the invite and accept packets, before the core adds them
+class GuildBan_ServerScript : public ServerScript
+{
+public:
+    GuildBan_ServerScript() : ServerScript("GuildBan_ServerScript") { }
+
+    bool CanPacketReceive(WorldSession* session, WorldPacket& packet) override
+    {
+        if (!sGuildBanMgr->IsEnabled())
+            return true;
+
+        switch (packet.GetOpcode())
+        {
+            case CMSG_GUILD_INVITE:
+                return CanInvite(session, packet);
+            case CMSG_GUILD_ACCEPT:
+                return CanAccept(session);
+            default:
+                return true;
         }
     }
+
+private:
+    static bool CanInvite(WorldSession* session, WorldPacket& packet)
+    {
+        Player* inviter = session->GetPlayer();
+        if (!inviter || !inviter->GetGuildId())
+            return true;
+
+        std::string name;
+        packet >> name;
+        // The core handler reads the packet again
+        packet.rpos(0);
+
+        // Unknown or offline players are reported by the core handler
+        Player* invitee = normalizePlayerName(name) ? ObjectAccessor::FindPlayerByName(name, false) : nullptr;
+        if (!invitee)
+            return true;
+
+        GuildBanScopedTimer timer(sGuildBanMgr->GetStats(), GUILD_BAN_TIMER_JOIN_CHECK);
+
+        if (!sGuildBanMgr->IsBanned(inviter->GetGuildId(), invitee->GetGUID().GetCounter(), invitee->GetSession()->GetAccountId()))
+            return true;
+
+        sGuildBanMgr->GetStats().Increment(GUILD_BAN_COUNTER_JOIN_REJECTED);
+
+        ChatHandler(session).PSendSysMessage("|cffff0000[Guild Ban]|r %s is banned from your guild and cannot be invited.",
+                                             invitee->GetName().c_str());
+        return false;
+    }
+
+    // Invites sent before the ban was issued
+    static bool CanAccept(WorldSession* session)
+    {
+        Player* player = session->GetPlayer();
+        if (!player || !player->GetGuildIdInvited())
+            return true;
+
+        uint32 guildId = player->GetGuildIdInvited();
+
+        GuildBanScopedTimer timer(sGuildBanMgr->GetStats(), GUILD_BAN_TIMER_JOIN_CHECK);
+
+        if (!sGuildBanMgr->IsBanned(guildId, player->GetGUID().GetCounter(), session->GetAccountId()))
+            return true;
+
+        sGuildBanMgr->GetStats().Increment(GUILD_BAN_COUNTER_JOIN_REJECTED);
+
+        // Same as declining the invite
+        player->SetGuildIdInvited(0);
+        player->SetInGuild(0);
+
+        sGuildBanMgr->RecordJoinAttempt(guildId, player->GetGUID().GetCounter());
+
+        if (sGuildBanMgr->ConsumeJoinAttempt(guildId, player->GetGUID().GetCounter()))
+            ChatHandler(session).PSendSysMessage("You are banned from this guild and cannot join.");
+
+        return false;
+    }
+};
+
+// Player Script keeping cached account characters current and purging bans of deleted characters
+class GuildBan_PlayerScript : public PlayerScript
+{
+public:
+    GuildBan_PlayerScript() : PlayerScript("GuildBan_PlayerScript") { }
+
+    void OnPlayerCreate(Player* player) override
+    {
+        sGuildBanMgr->AddAccountCharacter(player->GetSession()->GetAccountId(), player->GetGUID().GetCounter());
+    }
+
+    void OnPlayerDelete(ObjectGuid guid, uint32 accountId) override
+    {
+        sGuildBanMgr->RemoveAccountCharacter(accountId, guid.GetCounter());
+        sGuildBanMgr->PurgeCharacter(guid.GetCounter());
+    }
 };
 
 // World Script for loading config and data
@@ -263,12 +1876,29 @@ public:
 
     void OnStartup() override
     {
-        sGuildBanMgr->LoadFromDB();
+        sGuildBanMgr->Load();
+
+        // Guilds and the character cache are loaded before scripts start up
+        if (sGuildBanMgr->PurgeOrphansOnStartup())
+            sGuildBanMgr->PurgeOrphans();
+    }
+
+    void OnUpdate(uint32 diff) override
+    {
+        sGuildBanMgr->Update(diff);
+    }
+
+    void OnShutdown() override
+    {
+        sGuildBanMgr->FlushPendingWrites(true);
+        sGuildBanMgr->SaveSnapshot(true);
     }
 };
 
 void AddGuildBanScripts()
 {
     new GuildBan_GuildScript();
+    new GuildBan_ServerScript();
+    new GuildBan_PlayerScript();
     new GuildBan_WorldScript();
 }
@@ -0,0 +1,335 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GuildBan.h"
+#include "DatabaseEnv.h"
+#include "Log.h"
+#include "StringFormat.h"
+#include "Timer.h"
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+// Snapshot file layout, all integers in host byte order:
+//   header: magic, version, savedAt, count (uint32 each), payload size, payload FNV-1a checksum (uint64 each)
+//   per ban: guildId, guid, accountId, banDate, unbanDate (uint32 each), banType (uint8),
+//            bannedBy and banReason as uint16 length + bytes
+namespace
+{
+    constexpr uint32 SnapshotMagic = 0x4E534247; // "GBSN"
+    constexpr uint32 SnapshotVersion = 1;
+    constexpr std::size_t SnapshotHeaderSize = 4 * sizeof(uint32) + 2 * sizeof(uint64);
+
+    uint64 SnapshotChecksum(char const* data, std::size_t size)
+    {
+        uint64 hash = 0xCBF29CE484222325;
+        for (std::size_t i = 0; i < size; ++i)
+            hash = (hash ^ uint8(data[i])) * 0x100000001B3;
+
+        return hash;
+    }
+
+    // Same CRC-32 as MySQL's CRC32(), so the database can compute the digest server-side
+    uint32 Crc32(std::string_view data)
+    {
+        static std::array<uint32, 256> const table = []()
+        {
+            std::array<uint32, 256> result;
+            for (uint32 i = 0; i < 256; ++i)
+            {
+                uint32 crc = i;
+                for (uint32 bit = 0; bit < 8; ++bit)
+                    crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+
+                result[i] = crc;
+            }
+
+            return result;
+        }();
+
+        uint32 crc = 0xFFFFFFFF;
+        for (char c : data)
+            crc = (crc >> 8) ^ table[(crc ^ uint8(c)) & 0xFF];
+
+        return ~crc;
+    }
+
+    class SnapshotWriter
+    {
+    public:
+        template<typename T>
+        void Write(T value)
+        {
+            _data.append(reinterpret_cast<char const*>(&value), sizeof(T));
+        }
+
+        void WriteString(std::string_view str)
+        {
+            uint16 size = std::min<std::size_t>(str.size(), UINT16_MAX);
+            Write(size);
+            _data.append(str.data(), size);
+        }
+
+        std::string& Data() { return _data; }
+
+    private:
+        std::string _data;
+    };
+
+    class SnapshotReader
+    {
+    public:
+        SnapshotReader(char const* data, std::size_t size) : _data(data), _size(size) { }
+
+        template<typename T>
+        bool Read(T& value)
+        {
+            if (_size - _pos < sizeof(T))
+                return false;
+
+            std::memcpy(&value, _data + _pos, sizeof(T));
+            _pos += sizeof(T);
+            return true;
+        }
+
+        bool ReadString(std::string& str)
+        {
+            uint16 size;
+            if (!Read(size) || _size - _pos < size)
+                return false;
+
+            str.assign(_data + _pos, size);
+            _pos += size;
+            return true;
+        }
+
+        bool AtEnd() const { return _pos == _size; }
+
+    private:
+        char const* _data;
+        std::size_t _size;
+        std::size_t _pos = 0;
+    };
+
+    void WriteSnapshotFile(std::string const& fileName, std::string const& data)
+    {
+        // Written aside and renamed over the old file, a crash mid-write leaves the previous snapshot intact
+        std::string tempName = fileName + ".tmp";
+
+        {
+            std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+            if (!file.write(data.data(), data.size()))
+            {
+                LOG_ERROR("module", "Guild ban snapshot: could not write {}", tempName);
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempName, fileName, error);
+
+        if (error)
+            LOG_ERROR("module", "Guild ban snapshot: could not replace {}: {}", fileName, error.message());
+    }
+}
+
+void GuildBanMgr::Load()
+{
+    // A lazy load never reads the snapshot, it would hold every detail the lazy mode leaves out
+    if (_snapshotFile.empty() || _lazyLoading || !LoadSnapshot())
+        LoadFromDB();
+
+    PruneHistory();
+}
+
+void GuildBanMgr::SaveSnapshot(bool wait /*= false*/)
+{
+    // Details that are not loaded would be saved as empty
+    if (_snapshotFile.empty() || _detailsPartial)
+        return;
+
+    // One write at a time; a periodic save is skipped while the previous one is still running
+    if (_snapshotWrite.valid())
+    {
+        if (!wait && _snapshotWrite.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+
+        _snapshotWrite.get();
+    }
+
+    SnapshotWriter payload;
+    uint32 count = 0;
+
+    _bans.ForEach([&](GuildBanEntry const& ban)
+    {
+        payload.Write(ban.guildId);
+        payload.Write(ban.guid);
+        payload.Write(ban.accountId);
+        payload.Write(ban.banDate);
+        payload.Write(ban.unbanDate);
+        payload.Write(static_cast<uint8>(ban.banType));
+        payload.WriteString(ban.bannedBy);
+        payload.WriteString(ban.banReason);
+        ++count;
+    });
+
+    SnapshotWriter snapshot;
+    snapshot.Write(SnapshotMagic);
+    snapshot.Write(SnapshotVersion);
+    snapshot.Write(uint32(time(nullptr)));
+    snapshot.Write(count);
+    snapshot.Write(uint64(payload.Data().size()));
+    snapshot.Write(SnapshotChecksum(payload.Data().data(), payload.Data().size()));
+    snapshot.Data() += payload.Data();
+
+    // Serialized here so the file matches the state at this tick, the disk write happens off the world thread
+    if (wait)
+        WriteSnapshotFile(_snapshotFile, snapshot.Data());
+    else
+        _snapshotWrite = std::async(std::launch::async, [fileName = _snapshotFile, data = std::move(snapshot.Data())]()
+        {
+            WriteSnapshotFile(fileName, data);
+        });
+}
+
+bool GuildBanMgr::LoadSnapshot()
+{
+    GuildBanScopedTimer timer(_stats, GUILD_BAN_TIMER_LOAD);
+    uint32 oldMSTime = getMSTime();
+    uint32 now = time(nullptr);
+
+    std::ifstream file(_snapshotFile, std::ios::binary);
+    if (!file)
+    {
+        LOG_INFO("module", ">> Guild ban snapshot {} not found, loading from the database", _snapshotFile);
+        return false;
+    }
+
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    SnapshotReader header(data.data(), std::min(data.size(), SnapshotHeaderSize));
+    uint32 magic = 0, version = 0, savedAt = 0, count = 0;
+    uint64 payloadSize = 0, checksum = 0;
+
+    if (!header.Read(magic) || !header.Read(version) || !header.Read(savedAt) || !header.Read(count) ||
+        !header.Read(payloadSize) || !header.Read(checksum) || magic != SnapshotMagic || version != SnapshotVersion ||
+        payloadSize != data.size() - SnapshotHeaderSize ||
+        checksum != SnapshotChecksum(data.data() + SnapshotHeaderSize, payloadSize))
+    {
+        LOG_WARN("module", ">> Guild ban snapshot {} is invalid or from another version, loading from the database", _snapshotFile);
+        return false;
+    }
+
+    std::vector<std::vector<GuildBanInfo>> parts(1);
+    std::vector<GuildBanInfo>& bans = parts.front();
+    bans.reserve(count);
+
+    SnapshotReader reader(data.data() + SnapshotHeaderSize, payloadSize);
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        GuildBanInfo info;
+        uint8 banType;
+
+        if (!reader.Read(info.guildId) || !reader.Read(info.guid) || !reader.Read(info.accountId) ||
+            !reader.Read(info.banDate) || !reader.Read(info.unbanDate) || !reader.Read(banType) ||
+            !reader.ReadString(info.bannedBy) || !reader.ReadString(info.banReason))
+        {
+            LOG_WARN("module", ">> Guild ban snapshot {} is truncated, loading from the database", _snapshotFile);
+            return false;
+        }
+
+        // Bans that ran out while the server was down
+        if (info.unbanDate && info.unbanDate <= now)
+            continue;
+
+        info.banType = static_cast<GuildBanType>(banType);
+        bans.push_back(std::move(info));
+    }
+
+    if (!reader.AtEnd())
+    {
+        LOG_WARN("module", ">> Guild ban snapshot {} has trailing data, loading from the database", _snapshotFile);
+        return false;
+    }
+
+    LoadSharedLists();
+    uint32 loaded = ReplaceBans(parts);
+    _syncWatermark = uint64(savedAt) * IN_MILLISECONDS;
+    // Changes logged before this point are caught by the validation below
+    InitChangeLog();
+
+    CharacterDatabase.Execute("DELETE FROM guild_bans WHERE unbanDate BETWEEN 1 AND {}", now);
+
+    LOG_INFO("module", ">> Loaded {} guild bans from snapshot {} (saved {} s ago) in {} ms, validating against the database",
+        loaded, _snapshotFile, now > savedAt ? now - savedAt : 0, GetMSTimeDiffToNow(oldMSTime));
+
+    ValidateSnapshot(savedAt);
+    return true;
+}
+
+void GuildBanMgr::ValidateSnapshot(uint32 savedAt)
+{
+    uint32 now = time(nullptr);
+    uint64 count = 0;
+    uint64 maxBanDate = 0;
+    uint64 digest = 0;
+
+    // Order independent digest of every active ban, mirrored by the query below
+    _bans.ForEach([&](GuildBanEntry const& ban)
+    {
+        if (ban.unbanDate && ban.unbanDate <= now)
+            return;
+
+        ++count;
+        maxBanDate = std::max<uint64>(maxBanDate, ban.banDate);
+        digest ^= Crc32(Acore::StringFormat("{},{},{},{},{},{},{},{}", ban.guildId, ban.guid, ban.accountId,
+            ban.banDate, ban.unbanDate, static_cast<uint32>(ban.banType), ban.bannedBy, ban.banReason));
+    });
+
+    _queryProcessor.AddCallback(CharacterDatabase.AsyncQuery(
+        "SELECT CAST(COUNT(*) AS UNSIGNED), CAST(COALESCE(MAX(banDate), 0) AS UNSIGNED), "
+        "CAST(COALESCE(BIT_XOR(CRC32(CONCAT_WS(',', guildId, guid, accountId, banDate, unbanDate, banType, bannedBy, banReason))), 0) AS UNSIGNED) "
+        "FROM guild_bans WHERE unbanDate = 0 OR unbanDate > {}", now)
+        .WithCallback([this, count, maxBanDate, digest, savedAt](QueryResult result)
+        {
+            if (result)
+            {
+                Field* fields = result->Fetch();
+                if (fields[0].Get<uint64>() == count && fields[1].Get<uint64>() == maxBanDate && fields[2].Get<uint64>() == digest)
+                {
+                    LOG_INFO("module", "Guild ban snapshot matches the database ({} bans)", count);
+                    return;
+                }
+            }
+
+            // Bans changed since the snapshot was written, e.g. after a crash or an external edit.
+            // Only the difference is applied, the loaded bans stay in force meanwhile.
+            if (time(nullptr) < savedAt + DeletedRetention)
+            {
+                LOG_WARN("module", "Guild ban snapshot does not match the database, syncing changes made since it was saved");
+                SyncFromDB();
+            }
+            else
+            {
+                LOG_WARN("module", "Guild ban snapshot does not match the database and is older than the deletion log, repairing it in the background");
+                StartVerify(true);
+            }
+        }));
+}
@@ -0,0 +1,386 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GuildBan.h"
+#include "DatabaseEnv.h"
+#include "Log.h"
+#include "StringFormat.h"
+#include <algorithm>
+#include <chrono>
+
+// Background consistency pass between the loaded bans and guild_bans.
+// The table is read in primary key order, one keyset-paginated chunk per query, and each
+// chunk is compared over as many world updates as the per-tick budget needs. Rows that look
+// different are only suspects: they are read again in one batch and compared with the state
+// at that moment, so changes made while the pass runs are not reported. The table is the
+// reference, as for .gban reload; repairs make memory match it.
+namespace
+{
+    constexpr char const* VerifyColumns = "guildId, guid, accountId, banDate, unbanDate, bannedBy, banReason, banType";
+
+    GuildBanInfo ReadVerifyRow(Field* fields)
+    {
+        GuildBanInfo info;
+        info.guildId    = fields[0].Get<uint32>();
+        info.guid       = fields[1].Get<uint32>();
+        info.accountId  = fields[2].Get<uint32>();
+        info.banDate    = fields[3].Get<uint32>();
+        info.unbanDate  = fields[4].Get<uint32>();
+        info.bannedBy   = fields[5].Get<std::string>();
+        info.banReason  = fields[6].Get<std::string>();
+        info.banType    = static_cast<GuildBanType>(fields[7].Get<uint8>());
+        return info;
+    }
+
+    bool IsExpired(uint32 unbanDate, uint32 now)
+    {
+        return unbanDate && unbanDate <= now;
+    }
+}
+
+bool GuildBanMgr::StartVerify(bool repair)
+{
+    if (_verifyRunning)
+        return false;
+
+    _verifyRunning = true;
+    _verifyRepairPass = repair || _verifyRepair;
+    _verifyQueryInFlight = false;
+    _verifyLastChunk = false;
+    _verifyTailDone = false;
+    ++_verifyPass;
+    _verifyTimer = 0;
+    _verifyCursor = 0;
+    _verifyRows.clear();
+    _verifyRowPos = 0;
+    _verifyGuildId = 0;
+    _verifyGuildGuids.clear();
+    _verifyGuildMatched = 0;
+    _verifyCandidates.clear();
+
+    _verifyGuilds = _bans.GetGuildIds();
+    std::sort(_verifyGuilds.begin(), _verifyGuilds.end());
+    _verifyGuildPos = 0;
+
+    _verifyReport = GuildBanVerifyReport();
+    _verifyReport.startedAt = time(nullptr);
+
+    LOG_INFO("module", "Guild ban consistency check started ({} bans in memory)", _bans.Size());
+    return true;
+}
+
+void GuildBanMgr::CancelVerify()
+{
+    if (!_verifyRunning)
+        return;
+
+    _verifyRunning = false;
+    _verifyRows.clear();
+    _verifyGuilds.clear();
+    _verifyCandidates.clear();
+
+    LOG_INFO("module", "Guild ban consistency check aborted by a reload after {} rows", _verifyReport.rowsChecked);
+}
+
+void GuildBanMgr::UpdateVerify(uint32 diff)
+{
+    if (!_verifyRunning)
+    {
+        if (_verifyInterval && (_verifyTimer += diff) >= _verifyInterval)
+            StartVerify();
+
+        return;
+    }
+
+    if (_verifyQueryInFlight)
+        return;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(_verifyBudget);
+    uint32 checked = 0;
+
+    for (; _verifyRowPos < _verifyRows.size(); ++checked)
+    {
+        // Reading the clock costs about as much as checking a row
+        if (checked && !(checked % 32) && std::chrono::steady_clock::now() >= deadline)
+            return;
+
+        CheckVerifyRow(_verifyRows[_verifyRowPos++]);
+    }
+
+    if (_verifyLastChunk && !_verifyTailDone)
+    {
+        FinishVerifyGuild();
+
+        // Guilds after the last row of the table, under the same budget: after drift there can be many
+        for (; _verifyGuildPos < _verifyGuilds.size(); ++checked)
+        {
+            if (checked && !(checked % 32) && std::chrono::steady_clock::now() >= deadline)
+                return;
+
+            _verifyGuildId = _verifyGuilds[_verifyGuildPos++];
+            FinishVerifyGuild();
+        }
+
+        _verifyTailDone = true;
+
+        // The candidates are confirmed next tick
+        if (std::chrono::steady_clock::now() >= deadline)
+            return;
+    }
+
+    if (!_verifyCandidates.empty())
+        ConfirmVerifyCandidates();
+    else if (_verifyLastChunk)
+        FinishVerify();
+    else
+        FetchVerifyChunk();
+}
+
+void GuildBanMgr::FetchVerifyChunk()
+{
+    _verifyQueryInFlight = true;
+
+    _queryProcessor.AddCallback(CharacterDatabase.AsyncQuery(
+        "SELECT {} FROM guild_bans WHERE (guildId, guid) > ({}, {}) AND (unbanDate = 0 OR unbanDate > {}) "
+        "ORDER BY guildId, guid LIMIT {}",
+        VerifyColumns, GuildBanKeyGuildId(_verifyCursor), GuildBanKeyId(_verifyCursor), uint32(time(nullptr)), _verifyChunkSize)
+        .WithCallback([this, pass = _verifyPass](QueryResult result)
+        {
+            if (!_verifyRunning || pass != _verifyPass)
+                return;
+
+            _verifyQueryInFlight = false;
+            _verifyRows.clear();
+            _verifyRowPos = 0;
+
+            if (result)
+            {
+                do
+                {
+                    _verifyRows.push_back(ReadVerifyRow(result->Fetch()));
+                } while (result->NextRow());
+            }
+
+            _verifyLastChunk = _verifyRows.size() < _verifyChunkSize;
+
+            if (!_verifyRows.empty())
+                _verifyCursor = MakeGuildBanKey(_verifyRows.back().guildId, _verifyRows.back().guid);
+        }));
+}
+
+void GuildBanMgr::CheckVerifyRow(GuildBanInfo const& row)
+{
+    if (row.guildId != _verifyGuildId)
+    {
+        FinishVerifyGuild();
+
+        // Guilds in memory that the table has no rows for
+        for (; _verifyGuildPos < _verifyGuilds.size() && _verifyGuilds[_verifyGuildPos] < row.guildId; ++_verifyGuildPos)
+        {
+            _verifyGuildId = _verifyGuilds[_verifyGuildPos];
+            FinishVerifyGuild();
+        }
+
+        if (_verifyGuildPos < _verifyGuilds.size() && _verifyGuilds[_verifyGuildPos] == row.guildId)
+            ++_verifyGuildPos;
+
+        _verifyGuildId = row.guildId;
+    }
+
+    ++_verifyReport.rowsChecked;
+    _verifyGuildGuids.push_back(row.guid);
+
+    uint64 key = MakeGuildBanKey(row.guildId, row.guid);
+    Optional<GuildBanEntry> ban = _bans.Find(row.guildId, row.guid);
+
+    if (ban)
+        ++_verifyGuildMatched;
+
+    if (IsLocallyModified(key))
+        return;
+
+    if (!ban || !IsSameLoadedBan(*ban, row))
+    {
+        _verifyCandidates.push_back(key);
+        return;
+    }
+
+    // The record is right, check that lookups see it too
+    bool accountBan = ban->banType == GUILD_BAN_ACCOUNT && ban->accountId;
+    uint64 accountKey = MakeGuildBanKey(row.guildId, ban->accountId);
+
+    if (_index.ContainsCharacter(key) && (!accountBan || _index.ContainsAccount(accountKey)))
+        return;
+
+    ++_verifyReport.indexDrift;
+    LOG_WARN("module", "Guild ban consistency check: ban of guid {} in guild {} is missing from the lookup index", row.guid, row.guildId);
+
+    if (!_verifyRepairPass)
+        return;
+
+    GuildBanIndex::Writer writer(_index);
+    writer.InsertCharacter(key);
+
+    if (accountBan)
+        writer.InsertAccount(accountKey);
+
+    writer.Commit();
+    ++_verifyReport.repaired;
+}
+
+void GuildBanMgr::FinishVerifyGuild()
+{
+    if (!_verifyGuildId)
+        return;
+
+    // Every memory record beyond those matched by a row has no row of its own
+    std::vector<uint32> const* slots = _bans.GetGuildSlots(_verifyGuildId);
+    if (slots && slots->size() > _verifyGuildMatched)
+    {
+        uint32 now = time(nullptr);
+        std::sort(_verifyGuildGuids.begin(), _verifyGuildGuids.end());
+
+        for (uint32 slot : *slots)
+        {
+            GuildBanRecord const& record = _bans.GetRecord(slot);
+
+            if (IsExpired(record.unbanDate, now) || std::binary_search(_verifyGuildGuids.begin(), _verifyGuildGuids.end(), record.guid))
+                continue;
+
+            uint64 key = MakeGuildBanKey(record.guildId, record.guid);
+            if (!IsLocallyModified(key))
+                _verifyCandidates.push_back(key);
+        }
+    }
+
+    _verifyGuildId = 0;
+    _verifyGuildGuids.clear();
+    _verifyGuildMatched = 0;
+}
+
+void GuildBanMgr::ConfirmVerifyCandidates()
+{
+    std::size_t count = std::min<std::size_t>(_verifyCandidates.size(), _verifyChunkSize);
+    std::vector<uint64> keys(_verifyCandidates.end() - count, _verifyCandidates.end());
+    _verifyCandidates.resize(_verifyCandidates.size() - count);
+
+    std::string keyList;
+    for (uint64 key : keys)
+    {
+        if (!keyList.empty())
+            keyList += ", ";
+
+        keyList += Acore::StringFormat("({}, {})", GuildBanKeyGuildId(key), GuildBanKeyId(key));
+    }
+
+    _verifyQueryInFlight = true;
+
+    _queryProcessor.AddCallback(CharacterDatabase.AsyncQuery(
+        "SELECT {} FROM guild_bans WHERE (guildId, guid) IN ({}) AND (unbanDate = 0 OR unbanDate > {})",
+        VerifyColumns, keyList, uint32(time(nullptr)))
+        .WithCallback([this, pass = _verifyPass, keys = std::move(keys)](QueryResult result)
+        {
+            if (!_verifyRunning || pass != _verifyPass)
+                return;
+
+            _verifyQueryInFlight = false;
+
+            std::unordered_map<uint64, GuildBanInfo> rows;
+            if (result)
+            {
+                do
+                {
+                    GuildBanInfo info = ReadVerifyRow(result->Fetch());
+                    rows.emplace(MakeGuildBanKey(info.guildId, info.guid), std::move(info));
+                } while (result->NextRow());
+            }
+
+            uint32 now = time(nullptr);
+            std::vector<GuildBanInfo const*> toApply;
+            std::vector<uint64> toErase;
+
+            // Compared with the state right now, changes made since the chunk was read are not drift
+            for (uint64 key : keys)
+            {
+                if (IsLocallyModified(key))
+                    continue;
+
+                Optional<GuildBanEntry> ban = _bans.Find(GuildBanKeyGuildId(key), GuildBanKeyId(key));
+                if (ban && IsExpired(ban->unbanDate, now))
+                    ban.reset();
+
+                auto row = rows.find(key);
+
+                if (row != rows.end())
+                {
+                    if (ban && IsSameLoadedBan(*ban, row->second))
+                        continue;
+
+                    ++(ban ? _verifyReport.differing : _verifyReport.missingInMemory);
+                    toApply.push_back(&row->second);
+                }
+                else if (ban)
+                {
+                    ++_verifyReport.missingInDatabase;
+                    toErase.push_back(key);
+                }
+                else
+                    continue;
+
+                LOG_DEBUG("module", "Guild ban consistency check: ban of guid {} in guild {} {}", GuildBanKeyId(key),
+                    GuildBanKeyGuildId(key), row == rows.end() ? "has no row" : ban ? "differs from its row" : "is not loaded");
+            }
+
+            if (!_verifyRepairPass || (toApply.empty() && toErase.empty()))
+                return;
+
+            GuildBanIndex::Writer writer(_index);
+
+            for (GuildBanInfo const* info : toApply)
+                ApplyBan(*info, writer);
+
+            for (uint64 key : toErase)
+                _bans.Erase(GuildBanKeyGuildId(key), GuildBanKeyId(key), writer);
+
+            writer.Commit();
+            _verifyReport.repaired += toApply.size() + toErase.size();
+        }));
+}
+
+void GuildBanMgr::FinishVerify()
+{
+    _verifyRunning = false;
+    _verifyReport.finishedAt = time(nullptr);
+    _verifyRows.clear();
+    _verifyRows.shrink_to_fit();
+    _verifyGuilds.clear();
+    _verifyGuilds.shrink_to_fit();
+
+    GuildBanVerifyReport const& report = _verifyReport;
+    uint32 mismatches = report.missingInMemory + report.missingInDatabase + report.differing + report.indexDrift;
+
+    if (!mismatches)
+    {
+        LOG_INFO("module", "Guild ban consistency check: {} rows match memory ({} s)",
+            report.rowsChecked, report.finishedAt - report.startedAt);
+        return;
+    }
+
+    LOG_WARN("module", "Guild ban consistency check: {} rows checked, {} not loaded, {} loaded without a row, {} differing, "
+        "{} missing from the lookup index, {} repaired ({} s)", report.rowsChecked, report.missingInMemory,
+        report.missingInDatabase, report.differing, report.indexDrift, report.repaired, report.finishedAt - report.startedAt);
+}
@@ -0,0 +1,280 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Times the ban store and lookup index at a given number of bans and prints the results as JSON.
+// The rows come from an in-memory table standing in for guild_bans, split into guild id ranges
+// like GuildBanMgr::LoadFromDB does, so the load measures what ReplaceBans does with the query
+// results, not the database itself. Guild sizes follow a Zipf distribution: a few guilds hold
+// most bans, most guilds only a handful.
+//
+// Usage: guild_ban_bench [bans...]   (default: 1000 100000 1000000)
+
+#include "GuildBanStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint32 BansPerGuild = 40;
+    constexpr uint32 CharactersPerAccount = 3;
+    constexpr uint32 Officers = 50;
+    constexpr uint32 Reasons = 200;
+    constexpr uint32 Lookups = 1 << 20;
+    constexpr uint32 MaxChanges = 1000;
+    // Partitions LoadFromDB reads with four load threads, plus the one of the shared lists
+    constexpr uint32 GuildPartitions = 16;
+    // Rows per page of .gban list
+    constexpr uint32 PageSize = 15;
+
+    // Rows of guild_bans as the loader reads them. One in five is an account ban and
+    // three in ten are temporary; officer names and reasons repeat like on a live realm.
+    class FakeBanTable
+    {
+    public:
+        explicit FakeBanTable(uint32 count) : _guilds(std::max<uint32>(1, count / BansPerGuild)), _rng(count)
+        {
+            // Guild of rank r gets a share proportional to 1 / (r + 1), guild 1 is the largest
+            _cumulative.reserve(_guilds);
+            double total = 0;
+            for (uint32 rank = 0; rank < _guilds; ++rank)
+                _cumulative.push_back(total += 1.0 / (rank + 1));
+
+            _rows.reserve(count);
+            for (uint32 i = 0; i < count; ++i)
+                _rows.push_back(MakeRow(i));
+        }
+
+        GuildBanInfo MakeRow(uint32 i)
+        {
+            GuildBanInfo info;
+            info.guildId = PickGuild();
+            info.guid = 1 + i;
+            info.accountId = 1 + i / CharactersPerAccount;
+            info.banDate = 1700000000 + i;
+            info.unbanDate = i % 10 < 3 ? info.banDate + 86400 : 0;
+            info.bannedBy = "Officer" + std::to_string(i % Officers);
+            info.banReason = "Reason " + std::to_string(i % Reasons);
+            info.banType = i % 5 ? GUILD_BAN_CHARACTER : GUILD_BAN_ACCOUNT;
+            return info;
+        }
+
+        // The result sets of LoadGuildBanPartition: guild id ranges in primary key order
+        std::vector<std::vector<GuildBanInfo>> Partitions() const
+        {
+            std::vector<std::vector<GuildBanInfo>> parts(GuildPartitions + 1);
+            for (GuildBanInfo const& info : _rows)
+                parts[uint64(info.guildId - 1) * GuildPartitions / _guilds].push_back(info);
+
+            for (std::vector<GuildBanInfo>& part : parts)
+                std::sort(part.begin(), part.end(), [](GuildBanInfo const& left, GuildBanInfo const& right)
+                {
+                    return left.guildId != right.guildId ? left.guildId < right.guildId : left.guid < right.guid;
+                });
+
+            return parts;
+        }
+
+        std::vector<GuildBanInfo> const& Rows() const { return _rows; }
+        uint32 Guilds() const { return _guilds; }
+
+    private:
+        uint32 PickGuild()
+        {
+            double x = std::uniform_real_distribution<double>(0, _cumulative.back())(_rng);
+            return 1 + std::min<uint32>(std::lower_bound(_cumulative.begin(), _cumulative.end(), x) - _cumulative.begin(), _guilds - 1);
+        }
+
+        uint32 _guilds;
+        std::mt19937 _rng;
+        std::vector<double> _cumulative;
+        std::vector<GuildBanInfo> _rows;
+    };
+
+    struct Result
+    {
+        uint32 bans = 0;
+        uint32 guilds = 0;
+        uint32 largestGuildBans = 0;
+        uint32 medianGuildBans = 0;
+        double loadMs = 0;
+        double loadNsPerBan = 0;
+        double indexHitNs = 0;
+        double indexMissNs = 0;
+        double storeFindNs = 0;
+        double addRemoveUs = 0;
+        double pageFirstLargestUs = 0;
+        double pageLastLargestUs = 0;
+        double pageFirstMedianUs = 0;
+        std::size_t storeBytes = 0;
+        std::size_t indexBytes = 0;
+        double filterFalsePositiveRate = 0;
+    };
+
+    double ElapsedNs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    // Keeps the compiler from dropping lookups whose result is otherwise unused
+    uint64 Sink = 0;
+
+    // Microseconds per .gban list page, sorted newest first like the command's default
+    double TimePage(GuildBanStore const& store, uint32 guildId, uint32 offset, uint32 repeat)
+    {
+        std::vector<GuildBanEntry> page;
+        Clock::time_point start = Clock::now();
+        for (uint32 i = 0; i < repeat; ++i)
+            Sink += store.GetGuildPage(guildId, offset, PageSize, GUILD_BAN_SORT_DATE, page) + page.size();
+
+        return ElapsedNs(start) / repeat / 1e3;
+    }
+
+    Result Run(uint32 count)
+    {
+        FakeBanTable table(count);
+        std::vector<GuildBanInfo> const& rows = table.Rows();
+        std::vector<std::vector<GuildBanInfo>> parts = table.Partitions();
+
+        Result result;
+        result.bans = count;
+        result.guilds = table.Guilds();
+
+        GuildBanIndex index;
+        GuildBanStore store;
+
+        // Same steps as ReplaceBans: reset the index, fill the store from the partitions, publish once,
+        // heapify the expiries
+        Clock::time_point start = Clock::now();
+        {
+            GuildBanIndex::Writer writer(index, true);
+            std::vector<GuildBanExpiry> expiries;
+            store.Load(parts, writer, expiries);
+            writer.Commit();
+            std::make_heap(expiries.begin(), expiries.end(), std::greater<>());
+            Sink += expiries.size();
+        }
+        double loadNs = ElapsedNs(start);
+        result.loadMs = loadNs / 1e6;
+        result.loadNsPerBan = loadNs / count;
+
+        std::vector<uint32> sizes;
+        for (uint32 guildId : store.GetGuildIds())
+            sizes.push_back(store.GetGuildSlots(guildId)->size());
+        std::sort(sizes.begin(), sizes.end());
+        result.largestGuildBans = sizes.back();
+        result.medianGuildBans = sizes[sizes.size() / 2];
+
+        std::mt19937 rng(count);
+        std::uniform_int_distribution<uint32> pick(0, count - 1);
+        std::vector<uint32> order(Lookups);
+        for (uint32& i : order)
+            i = pick(rng);
+
+        // Bans checked the way a guild invite is: character and account key of one guild
+        start = Clock::now();
+        for (uint32 i : order)
+        {
+            GuildBanInfo const& info = rows[i];
+            Sink += index.Contains(MakeGuildBanKey(info.guildId, info.guid), MakeGuildBanKey(info.guildId, info.accountId));
+        }
+        result.indexHitNs = ElapsedNs(start) / Lookups;
+
+        // Characters and accounts past the end of the table are banned nowhere
+        start = Clock::now();
+        for (uint32 i : order)
+        {
+            uint32 guildId = rows[i].guildId;
+            Sink += index.Contains(MakeGuildBanKey(guildId, count + 1 + i), MakeGuildBanKey(guildId, count + 1 + i));
+        }
+        result.indexMissNs = ElapsedNs(start) / Lookups;
+
+        start = Clock::now();
+        for (uint32 i : order)
+            Sink += store.Find(rows[i].guildId, rows[i].guid).has_value();
+        result.storeFindNs = ElapsedNs(start) / Lookups;
+
+        // The largest guild sorts all its slots for every page, a typical one only a few
+        uint32 largestGuildId = 1;
+        uint32 medianGuildId = 1;
+        for (uint32 guildId : store.GetGuildIds())
+            if (store.GetGuildSlots(guildId)->size() == result.medianGuildBans)
+                medianGuildId = guildId;
+
+        uint32 lastPage = (result.largestGuildBans - 1) / PageSize * PageSize;
+        result.pageFirstLargestUs = TimePage(store, largestGuildId, 0, 100);
+        result.pageLastLargestUs = TimePage(store, largestGuildId, lastPage, 100);
+        result.pageFirstMedianUs = TimePage(store, medianGuildId, 0, 10000);
+
+        // One publish per change, like .gban add followed by .gban remove
+        uint32 changes = std::min(count, MaxChanges);
+        start = Clock::now();
+        for (uint32 i = 0; i < changes; ++i)
+        {
+            GuildBanInfo info = table.MakeRow(count + i);
+            {
+                GuildBanIndex::Writer writer(index);
+                store.Set(info, writer);
+                writer.Commit();
+            }
+            {
+                GuildBanIndex::Writer writer(index);
+                store.Erase(info.guildId, info.guid, writer);
+                writer.Commit();
+            }
+        }
+        result.addRemoveUs = ElapsedNs(start) / changes / 1e3;
+
+        result.storeBytes = store.MemoryUsage();
+        result.indexBytes = index.MemoryUsage();
+        result.filterFalsePositiveRate = index.GetFilterStats().estimatedFalsePositiveRate;
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<uint32> counts;
+    for (int i = 1; i < argc; ++i)
+        counts.push_back(std::max<uint32>(1, std::strtoul(argv[i], nullptr, 10)));
+
+    if (counts.empty())
+        counts = { 1000, 100000, 1000000 };
+
+    std::printf("{\n  \"lookups\": %u,\n  \"page_size\": %u,\n  \"scenarios\": [\n", Lookups, PageSize);
+    for (std::size_t i = 0; i < counts.size(); ++i)
+    {
+        Result r = Run(counts[i]);
+        std::printf("    {\"bans\": %u, \"guilds\": %u, \"largest_guild_bans\": %u, \"median_guild_bans\": %u, "
+                    "\"load_ms\": %.3f, \"load_ns_per_ban\": %.1f, \"index_hit_ns\": %.1f, \"index_miss_ns\": %.1f, "
+                    "\"store_find_ns\": %.1f, \"add_remove_us\": %.2f, \"page_first_largest_us\": %.2f, "
+                    "\"page_last_largest_us\": %.2f, \"page_first_median_us\": %.2f, \"store_bytes\": %zu, "
+                    "\"index_bytes\": %zu, \"filter_false_positive_rate\": %.6f}%s\n",
+                    r.bans, r.guilds, r.largestGuildBans, r.medianGuildBans, r.loadMs, r.loadNsPerBan, r.indexHitNs,
+                    r.indexMissNs, r.storeFindNs, r.addRemoveUs, r.pageFirstLargestUs, r.pageLastLargestUs,
+                    r.pageFirstMedianUs, r.storeBytes, r.indexBytes, r.filterFalsePositiveRate,
+                    i + 1 < counts.size() ? "," : "");
+    }
+    std::printf("  ],\n  \"checksum\": %llu\n}\n", static_cast<unsigned long long>(Sink));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,357 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Two worldservers share one characters database and follow each other through guild_bans_log.
+// The database is an in-memory stand-in for guild_bans, the log and the subscriptions; each
+// server applies what it polls with the same ApplyGuildBanLog and cursor as GuildBanMgr.
+
+#include "GuildBanChangeLog.h"
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+
+namespace
+{
+    uint32 Failures = 0;
+
+    void Check(bool condition, char const* what, int line)
+    {
+        if (!condition && ++Failures <= 20)
+            std::fprintf(stderr, "FAIL (line %d): %s\n", line, what);
+    }
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+    struct LogRow
+    {
+        GuildBanLogType type;
+        uint32 guildId;
+        uint32 guid;
+    };
+
+    struct FakeDatabase
+    {
+        std::map<uint64, GuildBanInfo> bans;
+        // (guildId, listId) of guild_ban_list_subscriptions
+        std::set<std::pair<uint32, uint32>> subscriptions;
+        // Committed guild_bans_log rows by seq; a reserved seq stays missing until its transaction commits
+        std::map<uint64, LogRow> log;
+        uint64 nextSeq = 1;
+
+        uint64 Reserve() { return nextSeq++; }
+        void Commit(uint64 seq, LogRow row) { log[seq] = row; }
+        void Log(LogRow row) { Commit(Reserve(), row); }
+
+        // SELECT ... FROM guild_bans_log l LEFT JOIN guild_bans b ... WHERE l.seq > after ORDER BY l.seq
+        std::vector<GuildBanLogEntry> Read(uint64 after) const
+        {
+            std::vector<GuildBanLogEntry> entries;
+            for (auto itr = log.upper_bound(after); itr != log.end(); ++itr)
+            {
+                GuildBanLogEntry& entry = entries.emplace_back();
+                entry.seq = itr->first;
+                entry.type = itr->second.type;
+                entry.guildId = itr->second.guildId;
+                entry.guid = itr->second.guid;
+
+                auto ban = bans.find(MakeGuildBanKey(entry.guildId, entry.guid));
+                if (entry.type == GUILD_BAN_LOG_BAN && entry.guid && ban != bans.end())
+                    entry.row = ban->second;
+            }
+
+            return entries;
+        }
+    };
+
+    // The parts of GuildBanMgr the change log touches
+    class Server
+    {
+    public:
+        explicit Server(FakeDatabase& db) : _db(db) { }
+
+        // AddBan followed by the flush that writes the row and its log entry
+        void Ban(GuildBanInfo const& info)
+        {
+            Apply(info);
+            _db.bans[MakeGuildBanKey(info.guildId, info.guid)] = info;
+            _db.Log({ GUILD_BAN_LOG_BAN, info.guildId, info.guid });
+        }
+
+        void Unban(uint32 guildId, uint32 guid)
+        {
+            GuildBanIndex::Writer writer(_index);
+            _bans.Erase(guildId, guid, writer);
+            writer.Commit();
+
+            _db.bans.erase(MakeGuildBanKey(guildId, guid));
+            _db.Log({ GUILD_BAN_LOG_BAN, guildId, guid });
+        }
+
+        void Subscribe(uint32 guildId, uint32 listId)
+        {
+            _db.subscriptions.emplace(guildId, listId);
+            _db.Log({ GUILD_BAN_LOG_SHARED_LISTS, guildId, 0 });
+            ReloadSharedLists();
+        }
+
+        void Unsubscribe(uint32 guildId, uint32 listId)
+        {
+            _db.subscriptions.erase({ guildId, listId });
+            _db.Log({ GUILD_BAN_LOG_SHARED_LISTS, guildId, 0 });
+            ReloadSharedLists();
+        }
+
+        // The rows stay until the chunked delete, the log entry tells the others right away
+        void PurgeGuild(uint32 guildId)
+        {
+            GuildBanIndex::Writer writer(_index);
+            DropGuild(guildId, writer);
+            writer.Commit();
+
+            std::erase_if(_db.subscriptions, [guildId](auto const& subscription) { return subscription.first == guildId; });
+            _db.Log({ GUILD_BAN_LOG_BAN, guildId, 0 });
+        }
+
+        // A ban changed here that is not flushed yet
+        void ChangeLocally(GuildBanInfo const& info)
+        {
+            Apply(info);
+            _pending.insert(MakeGuildBanKey(info.guildId, info.guid));
+        }
+
+        void Poll(uint32 nowMs)
+        {
+            std::vector<GuildBanLogEntry> entries = _db.Read(_cursor.GetSeq());
+
+            GuildBanLogResult result;
+            {
+                GuildBanIndex::Writer writer(_index);
+                result = ApplyGuildBanLog(std::span<GuildBanLogEntry const>(entries), *this, writer);
+                writer.Commit();
+            }
+
+            _cursor.Advance(entries, nowMs);
+
+            if (result.sharedListsChanged)
+                ReloadSharedLists();
+        }
+
+        bool IsBanned(uint32 guildId, uint32 guid, uint32 accountId) const
+        {
+            return _index.Contains(MakeGuildBanKey(guildId, guid), MakeGuildBanKey(guildId, accountId));
+        }
+
+        Optional<GuildBanEntry> GetBan(uint32 guildId, uint32 guid) const { return _bans.Find(guildId, guid); }
+        uint64 GetSeq() const { return _cursor.GetSeq(); }
+
+        // Target of ApplyGuildBanLog
+        bool IsLocallyModified(uint64 key) const { return _pending.contains(key); }
+
+        bool ApplyBan(GuildBanInfo const& info, GuildBanIndex::Writer& writer)
+        {
+            Optional<GuildBanEntry> current = _bans.Find(info.guildId, info.guid);
+            if (current && IsSameGuildBan(*current, info))
+                return false;
+
+            _bans.Set(info, writer);
+            return true;
+        }
+
+        bool EraseBan(uint32 guildId, uint32 guid, GuildBanIndex::Writer& writer) { return _bans.Erase(guildId, guid, writer); }
+
+        uint32 DropGuild(uint32 guildId, GuildBanIndex::Writer& writer)
+        {
+            if (_subscriptions.erase(guildId))
+                writer.SetSubscriptions(std::make_shared<GuildBanSubscriptions const>(_subscriptions));
+
+            return _bans.EraseGuild(guildId, writer);
+        }
+
+    private:
+        void Apply(GuildBanInfo const& info)
+        {
+            GuildBanIndex::Writer writer(_index);
+            _bans.Set(info, writer);
+            writer.Commit();
+        }
+
+        void ReloadSharedLists()
+        {
+            _subscriptions.clear();
+            for (auto const& [guildId, listId] : _db.subscriptions)
+                _subscriptions[guildId].push_back(MakeGuildBanListGuildId(listId));
+
+            GuildBanIndex::Writer writer(_index);
+            writer.SetSubscriptions(std::make_shared<GuildBanSubscriptions const>(_subscriptions));
+            writer.Commit();
+        }
+
+        FakeDatabase& _db;
+        GuildBanStore _bans;
+        GuildBanIndex _index;
+        GuildBanChangeLogCursor _cursor;
+        GuildBanSubscriptions _subscriptions;
+        std::set<uint64> _pending;
+    };
+
+    GuildBanInfo MakeBan(uint32 guildId, uint32 guid, uint32 accountId, GuildBanType type = GUILD_BAN_CHARACTER)
+    {
+        return { guildId, guid, accountId, 1700000000, 0, "Officer", "Reason", type };
+    }
+
+    void TestBanChanges()
+    {
+        FakeDatabase db;
+        Server a(db), b(db);
+
+        a.Ban(MakeBan(1, 100, 10));
+        a.Ban(MakeBan(1, 101, 11, GUILD_BAN_ACCOUNT));
+        b.Poll(0);
+        CHECK(b.IsBanned(1, 100, 10));
+        CHECK(b.IsBanned(1, 999, 11)); // another character of the banned account
+        CHECK(!b.IsBanned(2, 100, 10));
+
+        GuildBanInfo changed = MakeBan(1, 100, 10);
+        changed.banReason = "Changed";
+        a.Ban(changed);
+        b.Poll(0);
+        CHECK(b.GetBan(1, 100) && b.GetBan(1, 100)->banReason == "Changed");
+
+        a.Unban(1, 100);
+        a.Unban(1, 101);
+        b.Poll(0);
+        CHECK(!b.IsBanned(1, 100, 10));
+        CHECK(!b.IsBanned(1, 999, 11));
+
+        // Changes made on b reach a the same way
+        b.Ban(MakeBan(1, 102, 12));
+        a.Poll(0);
+        CHECK(a.IsBanned(1, 102, 12));
+        CHECK(a.GetSeq() == db.nextSeq - 1);
+    }
+
+    void TestLateCommit()
+    {
+        FakeDatabase db;
+        Server a(db), b(db);
+
+        // The first transaction takes its seq before the second one but commits after it
+        uint64 late = db.Reserve();
+        a.Ban(MakeBan(1, 200, 20));
+        b.Poll(0);
+        CHECK(b.IsBanned(1, 200, 20));
+        CHECK(b.GetSeq() == late - 1);
+
+        db.bans[MakeGuildBanKey(1, 201)] = MakeBan(1, 201, 21);
+        db.Commit(late, { GUILD_BAN_LOG_BAN, 1, 201 });
+        b.Poll(100);
+        CHECK(b.IsBanned(1, 201, 21));
+        CHECK(b.GetSeq() == db.nextSeq - 1);
+    }
+
+    void TestRollback()
+    {
+        FakeDatabase db;
+        Server a(db), b(db);
+
+        // Never committed
+        uint64 rolledBack = db.Reserve();
+        a.Ban(MakeBan(1, 300, 30));
+
+        b.Poll(1000);
+        CHECK(b.GetSeq() == rolledBack - 1);
+        b.Poll(1000 + GuildBanChangeLogCursor::GapTimeout - 1);
+        CHECK(b.GetSeq() == rolledBack - 1);
+        b.Poll(1000 + GuildBanChangeLogCursor::GapTimeout);
+        CHECK(b.GetSeq() == rolledBack + 1);
+        CHECK(b.IsBanned(1, 300, 30));
+    }
+
+    void TestLocalChangeWins()
+    {
+        FakeDatabase db;
+        Server a(db), b(db);
+
+        a.Ban(MakeBan(1, 400, 40));
+        b.Poll(0);
+
+        GuildBanInfo local = MakeBan(1, 400, 40);
+        local.banReason = "Local";
+        b.ChangeLocally(local);
+
+        GuildBanInfo remote = MakeBan(1, 400, 40);
+        remote.banReason = "Remote";
+        a.Ban(remote);
+        b.Poll(0);
+        CHECK(b.GetBan(1, 400) && b.GetBan(1, 400)->banReason == "Local");
+    }
+
+    void TestSharedLists()
+    {
+        FakeDatabase db;
+        Server a(db), b(db);
+
+        uint32 listGuildId = MakeGuildBanListGuildId(1);
+        a.Ban(MakeBan(listGuildId, 500, 50));
+        a.Subscribe(6, 1);
+        b.Poll(0);
+        CHECK(b.IsBanned(6, 500, 50));
+        CHECK(!b.IsBanned(7, 500, 50));
+
+        a.Unsubscribe(6, 1);
+        b.Poll(0);
+        CHECK(!b.IsBanned(6, 500, 50));
+    }
+
+    void TestPurge()
+    {
+        FakeDatabase db;
+        Server a(db), b(db);
+
+        a.Ban(MakeBan(MakeGuildBanListGuildId(1), 600, 60));
+        a.Ban(MakeBan(5, 601, 61));
+        a.Ban(MakeBan(5, 602, 62, GUILD_BAN_ACCOUNT));
+        a.Ban(MakeBan(8, 603, 63));
+        a.Subscribe(5, 1);
+        b.Poll(0);
+        CHECK(b.IsBanned(5, 600, 60));
+        CHECK(b.IsBanned(5, 601, 61));
+
+        // Rows of guild 5 are still in the table, only the log entry says it is gone
+        a.PurgeGuild(5);
+        b.Poll(0);
+        CHECK(!b.IsBanned(5, 600, 60));
+        CHECK(!b.IsBanned(5, 601, 61));
+        CHECK(!b.IsBanned(5, 999, 62));
+        CHECK(!b.GetBan(5, 601));
+        CHECK(b.IsBanned(8, 603, 63));
+    }
+}
+
+int main()
+{
+    TestBanChanges();
+    TestLateCommit();
+    TestRollback();
+    TestLocalChangeWins();
+    TestSharedLists();
+    TestPurge();
+
+    std::printf("%u failures\n", Failures);
+    return Failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Readers hammer the index while one writer keeps publishing snapshots. Each reader checks
+// that a lookup answers from a complete snapshot at least as new as the last one published
+// before it started. Under ASan or TSan this also catches a snapshot freed before its grace
+// period ended.
+//
+// Usage: guild_ban_index_stress [rounds] [readers]
+
+#include "GuildBanIndex.h"
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Keys inserted before the readers start and never removed
+    constexpr uint32 StableGuilds = 64;
+    constexpr uint32 StableIds = 16;
+    // The writer inserts id r into this guild in round r and removes id r - RollingWindow
+    constexpr uint32 RollingGuild = 1000;
+    constexpr uint32 RollingWindow = 8;
+    // Keys added and removed in other shards, they also keep the filter being rebuilt
+    constexpr uint32 ChurnGuildBase = 2000;
+    constexpr uint32 ChurnWindow = 256;
+    // Subscribes to the shared list whose only ban is ListBannedId
+    constexpr uint32 SubscriberGuild = 3000;
+    constexpr uint32 ListId = 1;
+    constexpr uint32 ListBannedId = 7;
+
+    std::atomic<uint32> Failures = 0;
+
+    void Fail(char const* what, uint64 key)
+    {
+        if (Failures.fetch_add(1) < 10)
+            std::fprintf(stderr, "FAIL: %s (guild %u, id %u)\n", what, GuildBanKeyGuildId(key), GuildBanKeyId(key));
+    }
+
+    std::shared_ptr<GuildBanSubscriptions const> MakeSubscriptions(uint32 round)
+    {
+        auto subscriptions = std::make_shared<GuildBanSubscriptions>();
+        (*subscriptions)[SubscriberGuild] = { MakeGuildBanListGuildId(ListId) };
+
+        // Changes every publish so the map readers look at is replaced all the time
+        (*subscriptions)[SubscriberGuild + 1 + round % 4] = { MakeGuildBanListGuildId(ListId) };
+        return subscriptions;
+    }
+
+    void Setup(GuildBanIndex& index)
+    {
+        GuildBanIndex::Writer writer(index);
+
+        for (uint32 guildId = 1; guildId <= StableGuilds; ++guildId)
+        {
+            for (uint32 id = 1; id <= StableIds; ++id)
+            {
+                writer.InsertCharacter(MakeGuildBanKey(guildId, id));
+                writer.InsertAccount(MakeGuildBanKey(guildId, id));
+            }
+        }
+
+        writer.InsertCharacter(MakeGuildBanKey(MakeGuildBanListGuildId(ListId), ListBannedId));
+        writer.SetSubscriptions(MakeSubscriptions(0));
+        writer.Commit();
+    }
+
+    void Write(GuildBanIndex& index, uint32 round)
+    {
+        GuildBanIndex::Writer writer(index);
+
+        writer.InsertCharacter(MakeGuildBanKey(RollingGuild, round));
+        writer.InsertAccount(MakeGuildBanKey(RollingGuild, round));
+
+        if (round > RollingWindow)
+        {
+            writer.EraseCharacter(MakeGuildBanKey(RollingGuild, round - RollingWindow));
+            writer.EraseAccount(MakeGuildBanKey(RollingGuild, round - RollingWindow));
+        }
+
+        writer.InsertCharacter(MakeGuildBanKey(ChurnGuildBase + round % ChurnWindow, round));
+        if (round > ChurnWindow)
+            writer.EraseCharacter(MakeGuildBanKey(ChurnGuildBase + (round - ChurnWindow) % ChurnWindow, round - ChurnWindow));
+
+        writer.SetSubscriptions(MakeSubscriptions(round));
+        writer.Commit();
+    }
+
+    void Read(GuildBanIndex const& index, std::atomic<uint32> const& published, std::atomic<bool> const& done,
+              uint64& reads)
+    {
+        for (uint32 i = 0; !done.load(); ++i)
+        {
+            uint32 round = published.load();
+
+            uint64 stable = MakeGuildBanKey(1 + i % StableGuilds, 1 + i % StableIds);
+            if (!index.ContainsCharacter(stable) || !index.ContainsAccount(stable))
+                Fail("stable key missing", stable);
+
+            uint64 unknown = MakeGuildBanKey(1 + i % StableGuilds, StableIds + 1 + i % 1000);
+            if (index.ContainsCharacter(unknown) || index.ContainsAccount(unknown))
+                Fail("key that was never inserted found", unknown);
+
+            if (!index.Contains(MakeGuildBanKey(SubscriberGuild, ListBannedId), MakeGuildBanKey(SubscriberGuild, 0)))
+                Fail("ban of a subscribed list missing", MakeGuildBanKey(SubscriberGuild, ListBannedId));
+
+            if (round)
+            {
+                // Published before this read started, so it must be seen unless it was removed meanwhile
+                uint64 latest = MakeGuildBanKey(RollingGuild, round);
+                bool found = index.ContainsCharacter(latest) && index.ContainsAccount(latest);
+                if (!found && published.load() < round + RollingWindow)
+                    Fail("published key missing", latest);
+            }
+
+            if (round > RollingWindow)
+            {
+                // Removed in a round that was published before this read started
+                uint64 removed = MakeGuildBanKey(RollingGuild, round - RollingWindow);
+                if (index.ContainsCharacter(removed) || index.ContainsAccount(removed))
+                    Fail("removed key still found", removed);
+            }
+
+            reads += 6;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32 rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    uint32 readerCount = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2;
+
+    GuildBanIndex index;
+    Setup(index);
+
+    std::atomic<uint32> published = 0;
+    std::atomic<bool> done = false;
+    std::vector<uint64> reads(readerCount, 0);
+    std::vector<std::thread> readers;
+
+    for (uint32 i = 0; i < readerCount; ++i)
+        readers.emplace_back(Read, std::cref(index), std::cref(published), std::cref(done), std::ref(reads[i]));
+
+    for (uint32 round = 1; round <= rounds; ++round)
+    {
+        Write(index, round);
+        published.store(round);
+    }
+
+    done.store(true);
+
+    uint64 totalReads = 0;
+    for (uint32 i = 0; i < readerCount; ++i)
+    {
+        readers[i].join();
+        totalReads += reads[i];
+    }
+
+    GuildBanIndex::FilterStats filter = index.GetFilterStats();
+    std::printf("%u publishes, %u readers, %llu lookups, %zu keys in the filter, %u failures\n", rounds, readerCount,
+                static_cast<unsigned long long>(totalReads), filter.keys, Failures.load());
+
+    return Failures.load() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+/*
+ * This file is part of the AzerothCore Project. See AUTHORS file for Copyright information
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The core's Optional alias, for the standalone test build only
+
+#ifndef _GUILD_BAN_TEST_OPTIONAL_H_
+#define _GUILD_BAN_TEST_OPTIONAL_H_
+
+#include <optional>
+
+template <class T>
+using Optional = std::optional<T>;
+
+#endif // _GUILD_BAN_TEST_OPTIONAL_H_